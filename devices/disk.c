@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -95,6 +96,7 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static int disk_id (const struct disk *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -213,6 +215,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
+	TRACE (TRACE_DISK_READ, disk_id (d), sec_no);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
@@ -220,6 +223,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
 	d->read_cnt++;
+	TRACE (TRACE_DISK_DONE, disk_id (d), sec_no);
 	lock_release (&c->lock);
 }
 
@@ -237,6 +241,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
+	TRACE (TRACE_DISK_WRITE, disk_id (d), sec_no);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
@@ -244,9 +249,17 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	output_sector (c, buffer);
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
+	TRACE (TRACE_DISK_DONE, disk_id (d), sec_no);
 	lock_release (&c->lock);
 }
 
+/* Returns D's number for tracing: 2 * channel + device, so that
+   hd1:0 is 2. */
+static int
+disk_id (const struct disk *d) {
+	return (d->channel - channels) * 2 + d->dev_no;
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -101,5 +101,10 @@ signal (struct intq *q UNUSED, struct thread **waiter) {
 	if (*waiter != NULL) {
 		thread_unblock (*waiter);
 		*waiter = NULL;
+
+		/* Our caller has interrupts off and may not be preempted,
+		   but an interrupt handler can yield on return. */
+		if (intr_context ())
+			thread_check_preempt ();
 	}
 }
@@ -1,12 +1,15 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
+#include "threads/profile.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -24,13 +27,62 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+#define NSEC_PER_SEC 1000000000
+#define NSEC_PER_TICK (NSEC_PER_SEC / TIMER_FREQ)
+
+/* Ticks over which timer_calibrate() measures the TSC and the
+   local APIC timer. */
+#define CALIBRATE_TICKS 2
+
+/* Time stamp counter rate in cycles per second, or 0 until
+   timer_calibrate(), and its value when the 8254 was started. */
+static uint64_t tsc_hz;
+static uint64_t tsc_boot;
+
+/* Local APIC timer rate in counts per second, or 0 if there is
+   no local APIC timer or it is not calibrated yet. */
+static uint64_t lapic_hz;
+
+/* Sleeps shorter than this cost less to spin through than to
+   block and be woken up for. */
+#define HR_SLEEP_MIN_NS 10000
+
+/* A thread in timer_msleep(), timer_usleep() or timer_nsleep(),
+   waiting for the local APIC timer. */
+struct hr_sleeper {
+	struct list_elem elem;      /* Element in hr_sleepers. */
+	int64_t deadline;           /* timer_ns() at which to wake up. */
+	struct thread *thread;      /* Sleeping thread. */
+};
+
+/* Sleeping threads, in ascending order of deadline.  The local
+   APIC timer is always set to go off at the first deadline. */
+static struct list hr_sleepers;
+
+static long long hr_sleep_cnt;  /* # of sleeps ended. */
+static long long hr_late_ns;    /* Total ns woken up after deadline. */
+
+/* Tickless idle.  When the idle thread is about to halt and no
+   sleeping thread is due on the next tick, the 8254's interrupt
+   is masked and the local APIC timer is set for the first tick
+   that has work to do.  The 8254 keeps counting meanwhile, so
+   the tick resumes in phase once it is unmasked. */
+static bool tick_stopped;           /* 8254 interrupt masked? */
+static int64_t last_tick_ns;        /* timer_ns() at the latest tick. */
+static long long tickless_cnt;      /* # of times the tick was stopped. */
+static long long suppressed_ticks;  /* # of tick interrupts never taken. */
+
 static intr_handler_func timer_interrupt;
+static intr_handler_func lapic_timer_interrupt;
+static void tick (void);
+static void hr_sleep (int64_t ns);
+static void hr_arm (int64_t deadline);
+static bool deadline_less (const struct list_elem *,
+		const struct list_elem *, void *aux);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 
-//static struct list *sleep_thread_list;
-
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
@@ -45,12 +97,20 @@ timer_init (void) {
 	outb (0x40, count >> 8);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	tsc_boot = rdtsc ();
+
+	list_init (&hr_sleepers);
+	if (lapic_timer_present ())
+		intr_register_ext (INTR_LAPIC_TIMER, lapic_timer_interrupt,
+				"Local APIC Timer");
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
 void
 timer_calibrate (void) {
 	unsigned high_bit, test_bit;
+	int64_t start;
+	uint64_t tsc_start;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
@@ -70,6 +130,26 @@ timer_calibrate (void) {
 			loops_per_tick |= test_bit;
 
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+	/* Measure the TSC, and the local APIC timer if there is one,
+	   against the 8254. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	start = ticks;
+	tsc_start = rdtsc ();
+	if (lapic_timer_present ())
+		lapic_timer_start (UINT32_MAX);
+	while (ticks - start < CALIBRATE_TICKS)
+		barrier ();
+	tsc_hz = (rdtsc () - tsc_start) * TIMER_FREQ / CALIBRATE_TICKS;
+	if (lapic_timer_present ()) {
+		lapic_hz = (uint64_t) (UINT32_MAX - lapic_timer_count ())
+			* TIMER_FREQ / CALIBRATE_TICKS;
+		lapic_timer_start (0);
+	}
+	printf ("TSC: %'"PRIu64" Hz, local APIC timer: %'"PRIu64" Hz.\n",
+			tsc_hz, lapic_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -88,15 +168,34 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
-/* Suspends execution for approximately TICKS timer ticks. */
+/* Returns the number of nanoseconds since the OS booted, read
+   from the time stamp counter.  Until timer_calibrate() has
+   measured the TSC, falls back to the tick count. */
+int64_t
+timer_ns (void) {
+	uint64_t cycles;
+
+	if (tsc_hz == 0)
+		return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+
+	/* Split the division so that the multiplication cannot
+	   overflow. */
+	cycles = rdtsc () - tsc_boot;
+	return cycles / tsc_hz * NSEC_PER_SEC
+		+ cycles % tsc_hz * NSEC_PER_SEC / tsc_hz;
+}
 
+/* Suspends execution for approximately TICKS timer ticks.  The
+   thread is blocked, not spinning, until the timer interrupt
+   wakes it up. */
 void
 timer_sleep (int64_t ticks) {
 	int64_t start = timer_ticks ();
 
 	ASSERT (intr_get_level () == INTR_ON);
-	while (timer_elapsed (start) < ticks)
-		thread_yield ();
+	if (ticks <= 0)
+		return;
+	thread_sleep (start + ticks);
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -121,13 +220,99 @@ timer_nsleep (int64_t ns) {
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (lapic_hz != 0) {
+		printf ("High-resolution sleeps: %lld, %lld ns late on average\n",
+				hr_sleep_cnt, hr_sleep_cnt > 0 ? hr_late_ns / hr_sleep_cnt : 0);
+		printf ("Tickless idle: %lld ticks suppressed in %lld idle periods\n",
+				suppressed_ticks, tickless_cnt);
+	}
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  If no tick is needed before some later one, stops the
+   periodic tick and sets the local APIC timer for that tick.  The
+   local APIC timer reaches at most a second ahead, so the idle
+   thread wakes up at least once a second. */
+void
+timer_idle_enter (void) {
+	int64_t next, deadline;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lapic_hz == 0)
+		return;
+
+	next = thread_next_wakeup ();
+	if (next - ticks > TIMER_FREQ)
+		next = ticks + TIMER_FREQ;
+	if (thread_mlfqs) {
+		/* The once-a-second load average update must happen on a
+		   real tick. */
+		int64_t second = (ticks / TIMER_FREQ + 1) * TIMER_FREQ;
+		if (next > second)
+			next = second;
+	}
+	if (next <= ticks + 1)
+		return;
+
+	intr_mask_ext (0x20, true);
+	tick_stopped = true;
+	tickless_cnt++;
+
+	deadline = last_tick_ns + (next - ticks) * NSEC_PER_TICK;
+	if (list_empty (&hr_sleepers)
+			|| deadline < list_entry (list_front (&hr_sleepers),
+				struct hr_sleeper, elem)->deadline)
+		hr_arm (deadline);
+}
+
+/* Called at the start of every external interrupt.  If
+   timer_idle_enter() stopped the tick, catches the tick count and
+   the statistics up with the time and restarts the tick. */
+void
+timer_idle_exit (void) {
+	int64_t missed;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!tick_stopped)
+		return;
+	tick_stopped = false;
+
+	/* Skip all but the last missed tick.  If the 8254 interrupted
+	   while masked, the PIC delivers that interrupt as soon as it
+	   is unmasked, and it stands for the last tick; otherwise, take
+	   the last tick here. */
+	missed = (timer_ns () - last_tick_ns) / NSEC_PER_TICK;
+	if (missed > 0) {
+		ticks += missed - 1;
+		last_tick_ns += (missed - 1) * NSEC_PER_TICK;
+		thread_skip_ticks (missed - 1);
+		suppressed_ticks += missed - 1;
+		if (!intr_ext_pending (0x20)) {
+			last_tick_ns += NSEC_PER_TICK;
+			suppressed_ticks++;
+			tick ();
+		}
+	}
+	intr_mask_ext (0x20, false);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
+	last_tick_ns = timer_ns ();
+	if (profile_enabled)
+		profile_sample (args);
+	tick ();
+}
+
+/* Advances the tick count by one and does the work of a tick. */
+static void
+tick (void) {
 	ticks++;
 	thread_tick ();
+	thread_wakeup (ticks);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -164,6 +349,16 @@ busy_wait (int64_t loops) {
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom) {
+	if (lapic_hz != 0) {
+		/* Sleep until a local APIC timer deadline, accurate to well
+		   under a microsecond instead of to the tick. */
+		ASSERT (NSEC_PER_SEC % denom == 0);
+		ASSERT (intr_get_level () == INTR_ON);
+		hr_sleep (num * (NSEC_PER_SEC / denom));
+		return;
+	}
+
+
 	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
 
 	   (NUM / DENOM) s
@@ -185,4 +380,80 @@ real_time_sleep (int64_t num, int32_t denom) {
 		ASSERT (denom % 1000 == 0);
 		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
-}
\ No newline at end of file
+}
+
+/* Blocks the current thread for NS nanoseconds, using the local
+   APIC timer to wake it up.  Sleeps too short to be worth a
+   context switch spin on the TSC instead. */
+static void
+hr_sleep (int64_t ns) {
+	struct hr_sleeper s;
+	enum intr_level old_level;
+
+	if (ns <= 0)
+		return;
+	s.deadline = timer_ns () + ns;
+	if (ns < HR_SLEEP_MIN_NS) {
+		while (timer_ns () < s.deadline)
+			continue;
+		return;
+	}
+
+	s.thread = thread_current ();
+	old_level = intr_disable ();
+	list_insert_ordered (&hr_sleepers, &s.elem, deadline_less, NULL);
+	if (list_front (&hr_sleepers) == &s.elem)
+		hr_arm (s.deadline);
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Sets the local APIC timer to go off at DEADLINE, or as soon as
+   possible if DEADLINE has passed.  A deadline more than a second
+   away is approached a second at a time, to keep the count within
+   the timer's 32 bits. */
+static void
+hr_arm (int64_t deadline) {
+	int64_t delta = deadline - timer_ns ();
+	uint64_t count;
+
+	if (delta < 0)
+		delta = 0;
+	if (delta >= NSEC_PER_SEC)
+		count = lapic_hz;
+	else
+		count = delta * lapic_hz / NSEC_PER_SEC + 1;
+	lapic_timer_start (count < UINT32_MAX ? count : UINT32_MAX);
+}
+
+/* Local APIC timer interrupt handler.  Wakes up every sleeper
+   whose deadline has passed and sets the timer for the next. */
+static void
+lapic_timer_interrupt (struct intr_frame *args UNUSED) {
+	int64_t now = timer_ns ();
+
+	while (!list_empty (&hr_sleepers)) {
+		struct hr_sleeper *s = list_entry (list_front (&hr_sleepers),
+				struct hr_sleeper, elem);
+		if (s->deadline > now)
+			break;
+
+		list_pop_front (&hr_sleepers);
+		hr_sleep_cnt++;
+		hr_late_ns += now - s->deadline;
+		thread_unblock (s->thread);
+	}
+	if (!list_empty (&hr_sleepers))
+		hr_arm (list_entry (list_front (&hr_sleepers),
+					struct hr_sleeper, elem)->deadline);
+	thread_check_preempt ();
+}
+
+/* Returns true if the deadline of hr_sleeper A is earlier than
+   that of hr_sleeper B. */
+static bool
+deadline_less (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct hr_sleeper, elem)->deadline
+		< list_entry (b, struct hr_sleeper, elem)->deadline;
+}
@@ -7,6 +7,8 @@
 #include "filesys/free-map.h"
 #include "filesys/fat.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/workqueue.h"
 
 static struct fat_fs *fat_fs;
 
@@ -22,6 +24,16 @@ struct inode_disk {
 	uint32_t unused[125];               /* Not used. */
 };
 
+/* Clusters of a removed inode waiting to be freed by the work
+ * queue. */
+struct inode_reclaim {
+	struct work work;                   /* Deferred work. */
+	cluster_t inode_clst;               /* Cluster holding the inode. */
+	cluster_t data_clst;                /* First data cluster. */
+};
+
+static void inode_reclaim (struct work *);
+
 /* Returns the number of sectors to allocate for an inode SIZE
  * bytes long. */
 static inline size_t
@@ -68,10 +80,15 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of in-memory inodes, which malloc() would round up to
+ * twice their size. */
+static struct slab_cache inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	slab_init (&inode_cache, "inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -157,7 +174,7 @@ inode_open (disk_sector_t sector) {
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = slab_alloc (&inode_cache);
 	if (inode == NULL)
 		return NULL;
 
@@ -199,18 +216,38 @@ inode_close (struct inode *inode) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
 
-		/* Deallocate blocks if removed. */
+		/* Deallocate blocks if removed.  Walking the FAT chains can
+		 * take a while for a large file, so leave it to the work
+		 * queue unless we are out of memory. */
 		if (inode->removed) {
 			//free_map_release (inode->sector, 1);
 			//free_map_release (inode->data.start, bytes_to_sectors (inode->data.length));
-			fat_remove_chain(sector_to_cluster(inode -> sector), 0);
-			fat_remove_chain(sector_to_cluster(inode -> data.start), 0);
+			struct inode_reclaim *r = malloc (sizeof *r);
+			if (r != NULL) {
+				r->inode_clst = sector_to_cluster (inode->sector);
+				r->data_clst = sector_to_cluster (inode->data.start);
+				work_init (&r->work, inode_reclaim);
+				work_queue (&r->work);
+			} else {
+				fat_remove_chain(sector_to_cluster(inode -> sector), 0);
+				fat_remove_chain(sector_to_cluster(inode -> data.start), 0);
+			}
 		}
 
-		free (inode); 
+		slab_free (&inode_cache, inode);
 	}
 }
 
+/* Frees the clusters of a removed inode.  Runs on the work queue. */
+static void
+inode_reclaim (struct work *work) {
+	struct inode_reclaim *r = work_entry (work, struct inode_reclaim, work);
+
+	fat_remove_chain (r->inode_clst, 0);
+	fat_remove_chain (r->data_clst, 0);
+	free (r);
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
  * has it open. */
 void
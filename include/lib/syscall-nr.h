@@ -36,6 +36,10 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* User-level synchronization. */
+	SYS_FUTEX_WAIT,             /* Sleep if a futex holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a futex. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,26 @@
+#ifndef __LIB_USER_MUTEX_H
+#define __LIB_USER_MUTEX_H
+
+/* User-level mutex built on futex_wait() and futex_wake().
+
+   Locking and unlocking an uncontended mutex are a single atomic
+   instruction each, with no system call.  Only a thread that
+   finds the mutex held sleeps in the kernel, and only an unlock
+   that knows somebody may be sleeping enters the kernel to wake
+   it.  See Ulrich Drepper, "Futexes Are Tricky", for the
+   algorithm. */
+
+/* A mutex.  Initialize with MUTEX_INITIALIZER or mutex_init(). */
+struct mutex {
+	int state;                  /* 0: unlocked, 1: locked,
+	                               2: locked, maybe with sleepers. */
+};
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+int mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+#endif /* lib/user/mutex.h */
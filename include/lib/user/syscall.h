@@ -16,6 +16,10 @@ typedef int off_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Results of futex_wait() other than waking up. */
+#define FUTEX_CHANGED (-1)      /* *ADDR differed, or bad address. */
+#define FUTEX_AGAIN (-2)        /* No other thread could wake us. */
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -50,6 +54,12 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* User-level synchronization. */
+/* Processes have one thread each, so futex_wait() never sleeps
+   yet: it returns FUTEX_AGAIN where it would have. */
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int n);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
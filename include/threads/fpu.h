@@ -0,0 +1,14 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+void fpu_init (void);
+void fpu_switch (struct thread *next);
+bool fpu_fork (struct thread *child, struct thread *parent);
+void fpu_release (void);
+void fpu_print_stats (void);
+
+#endif /* threads/fpu.h */
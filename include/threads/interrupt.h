@@ -71,8 +71,19 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
+void intr_mask_ext (uint8_t vec, bool mask);
+bool intr_ext_pending (uint8_t vec);
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
+/* Local APIC timer.  It interrupts at vector INTR_LAPIC_TIMER,
+   which is registered with intr_register_ext() like the
+   interrupts that come through the PICs. */
+#define INTR_LAPIC_TIMER 0x30
+
+bool lapic_timer_present (void);
+void lapic_timer_start (uint32_t count);
+uint32_t lapic_timer_count (void);
+
 #endif /* threads/interrupt.h */
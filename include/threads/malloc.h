@@ -5,6 +5,7 @@
 #include <stddef.h>
 
 void malloc_init (void);
+void malloc_print_stats (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
@@ -0,0 +1,28 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+/* Sampling profiler.
+
+   When the kernel is booted with "-profile", every timer
+   interrupt records the interrupted instruction and the chain of
+   return addresses found by following saved frame pointers,
+   first through the kernel stack and then, for a user process,
+   through its user stack.  Identical stacks are counted together
+   in a fixed-size table, which is printed at power off, one stack
+   per line in "folded" form: frames from outermost to innermost,
+   separated by semicolons, then the sample count.  Addresses are
+   printed in hex, with user addresses prefixed by "u";
+   utils/profile-fold resolves them to function names for
+   flame-graph tools. */
+
+struct intr_frame;
+
+extern bool profile_enabled;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+#endif /* threads/profile.h */
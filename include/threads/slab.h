@@ -0,0 +1,51 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Slab allocator.
+
+   A slab cache hands out objects of one fixed size, such as
+   struct page or struct inode, packed into pages obtained from
+   the page allocator.  Compared with malloc(), which rounds each
+   request up to a power of two and shares one free list among
+   every object of that size class, a cache wastes less memory per
+   object and keeps its own lock and statistics.
+
+   An object is constructed once, when the page holding it is
+   added to the cache, and must be returned to the cache in its
+   constructed state: slab_alloc() does not construct it again. */
+
+/* Initializes the object at OBJ. */
+typedef void slab_ctor (void *obj);
+
+/* A cache of objects of one size. */
+struct slab_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t size;                /* Size of each object. */
+	size_t stride;              /* Distance between objects. */
+	size_t first;               /* Offset of first object in a slab. */
+	size_t obj_cnt;             /* Objects per slab. */
+	slab_ctor *ctor;            /* Constructor, or null. */
+	struct lock lock;           /* Protects everything below. */
+	struct list partial;        /* Slabs with free objects. */
+	struct list full;           /* Slabs with no free objects. */
+	size_t slab_cnt;            /* Number of slabs. */
+	size_t empty_cnt;           /* Slabs with no objects in use. */
+
+	/* Statistics. */
+	size_t in_use;              /* Objects allocated. */
+	size_t max_in_use;          /* Most objects allocated at once. */
+	long long alloc_cnt;        /* Calls to slab_alloc(). */
+	long long free_cnt;         /* Calls to slab_free(). */
+};
+
+void slab_init (struct slab_cache *, const char *name, size_t size,
+		size_t align, slab_ctor *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
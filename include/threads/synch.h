@@ -2,12 +2,15 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
 
+struct thread;
+
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct rb_tree waiters;     /* Waiting threads, highest priority first. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,6 +23,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct list_elem elem;      /* Element in holder's list of locks. */
+	int max_priority;           /* Highest priority donated by a waiter. */
 };
 
 void lock_init (struct lock *);
@@ -30,7 +35,7 @@ bool lock_held_by_current_thread (const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct rb_tree waiters;     /* Waiting threads, highest priority first. */
 };
 
 void cond_init (struct condition *);
@@ -38,6 +43,32 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+void synch_set_priority (struct thread *, int priority);
+
+/* Read-write lock. */
+struct rwlock {
+	struct lock lock;           /* Held by a writer, or by a reader entering. */
+	unsigned readers;           /* Number of readers inside. */
+	bool writer_waiting;        /* Is a writer waiting for readers to leave? */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+	struct list holds;          /* Read holds, for donation. */
+	int max_priority;           /* Priority donated to readers by writer. */
+};
+
+/* A thread's read hold on a read-write lock, which lets a waiting
+   writer find the readers to donate its priority to. */
+struct rwlock_hold {
+	struct list_elem elem;      /* Element in the rwlock's holds. */
+	struct thread *thread;      /* Reader, or null if slot is unused. */
+	struct rwlock *rwlock;      /* Lock held for reading. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
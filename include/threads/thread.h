@@ -3,12 +3,15 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "threads/fixed-point.h"
 #include "filesys/file.h"
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "threads/workqueue.h"
 #endif
 
 
@@ -30,6 +33,15 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the 4.4BSD scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
+/* Read-write locks a thread can hold for reading at once and
+   still receive priority donation through. */
+#define READ_HOLD_MAX 4
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -81,23 +93,70 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue or in the
+ * list of sleeping threads (thread.c).  A ready CFS or EDF thread
+ * is in its run queue tree through `cfs_elem' or `rt_elem'
+ * instead, and a thread waiting on a semaphore is in the
+ * semaphore's waiters through `wait_elem' (synch.c), which is
+ * kept ordered by priority.  Since a thread is in at most one of
+ * these lists and trees at a time, the four share storage.  A
+ * thread waiting on a condition variable is also in the
+ * condition's waiters through `cond_elem'. */
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;                          /* Thread identifier. */
 	enum thread_status status;          /* Thread state. */
 	char name[16];                      /* Name (for debugging purposes). */
-	int priority;                       /* Priority. */
-    
-    bool donated;
-	int donated_priority;
+	int priority;                       /* Effective priority. */
+	int base_priority;                  /* Priority before donation. */
+	struct list locks;                  /* Locks held, for donation. */
+	struct lock *wait_on_lock;          /* Lock being waited for, if any. */
+	struct rwlock *wait_on_rwlock;      /* Read-write lock being drained. */
+	struct rwlock_hold *read_holds;     /* READ_HOLD_MAX read lock slots,
+	                                       allocated on first use. */
+	int64_t wakeup_tick;                /* Tick to wake up at, if sleeping. */
+	struct list_elem all_elem;          /* Element in the list of all threads. */
+	struct list_elem tid_elem;          /* Element in the tid table. */
+
+	/* Owned by thread.c, used only by the 4.4BSD scheduler. */
+	int nice;                           /* Niceness, -20...20. */
+	fixed_t recent_cpu;                 /* Recently used CPU time. */
+	bool cpu_dirty;                     /* On the dirty list? */
+	struct list_elem cpu_dirty_elem;    /* Dirty list element. */
+
+	/* Owned by thread.c, used only by the completely fair scheduler. */
+	int64_t vruntime;                   /* Weighted virtual runtime. */
+
+	/* Owned by thread.c, used only by earliest-deadline-first threads. */
+	int64_t rt_period;                  /* Period in ticks, 0 if not EDF. */
+	int64_t rt_budget;                  /* CPU ticks allowed per period. */
+	int64_t rt_runtime;                 /* Budget left in this period. */
+	int64_t rt_deadline;                /* End of the current period. */
+	bool rt_job_done;                   /* Finished this period's work? */
+	bool rt_throttled;                  /* Out of budget this period? */
+	unsigned rt_missed;                 /* # of deadlines missed. */
+
+	/* Owned by thread.c, scheduling statistics. */
+	int64_t ready_tick;                 /* Tick it last became ready. */
+	int64_t wait_ticks;                 /* Ticks spent ready, not running. */
+	int64_t user_ticks;                 /* Ticks run in user programs. */
+	int64_t kernel_ticks;               /* Ticks run in the kernel. */
+	unsigned voluntary_switches;        /* Times it gave up the CPU. */
+	unsigned involuntary_switches;      /* Times it was preempted. */
+
+	/* Owned by threads/fpu.c. */
+	void *fpu;                          /* Saved FPU state, or null. */
+
 	/* Shared between thread.c and synch.c. */
-	struct list_elem elem;              /* List element. */
+	union {
+		struct list_elem elem;          /* List element. */
+		struct rb_elem cfs_elem;        /* CFS run queue tree element. */
+		struct rb_elem rt_elem;         /* EDF run queue element. */
+		struct rb_elem wait_elem;       /* Semaphore waiters element. */
+	};
+	struct semaphore *wait_sema;        /* Semaphore waited on, if any. */
+	struct rb_elem *cond_elem;          /* Condition waiters element. */
+	struct condition *wait_cond;        /* Condition waited on, if any. */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -109,19 +168,14 @@ struct thread {
 	struct thread *parent;
     int parent_id; //for finding parent of child
 
-	struct list_elem child_elem;
-	struct list childs;
+	struct list children;               /* Exit records of children. */
+	struct exit_record *exit_rec;       /* Own exit record, or null. */
 
-	struct semaphore sema_exit;
-	struct semaphore sema_wait;
     struct semaphore sema_fork;
 
 
 	int exit_status;
 
-	bool is_waited;
-	bool is_exited;
-
 	bool fork_error;
     uintptr_t cur_rsp;
 
@@ -129,7 +183,8 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
-    
+	/* Write-backs of this thread's mapped pages still queued. */
+	struct work_group writebacks;
 #endif
 
 	/* Owned by thread.c. */
@@ -144,6 +199,10 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
@@ -158,25 +217,33 @@ void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
+struct thread *thread_find (tid_t);
+#ifdef USERPROG
+bool thread_pml4_shared (uint64_t *pml4);
+#endif
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *);
+void thread_check_preempt (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
+bool thread_set_period (int64_t period, int64_t budget);
+void thread_wait_period (void);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+void thread_sleep (int64_t wakeup_tick);
+void thread_wakeup (int64_t now);
+int64_t thread_next_wakeup (void);
+void thread_skip_ticks (int64_t cnt);
+
 void do_iret (struct intr_frame *tf);
 
-/*
-void sleep_thread(int64_t);
-void time_to_wake_up(int64_t);
-bool prior_wake_time(const struct list_elem *, const struct list_elem *, void *aux);
-bool larger_priority(const struct list_elem *, const struct list_elem *, void *aux);
-*/
 #endif /* threads/thread.h */
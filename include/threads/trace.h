@@ -0,0 +1,58 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   Tracepoints in the scheduler, page fault handler, disk driver,
+   system call handler and page allocator each append a fixed-size
+   record to a ring buffer allocated at boot, without taking any
+   lock, so they are cheap enough to leave in place and safe to
+   hit from interrupt handlers.  Tracing is off unless the kernel
+   is booted with "-trace".  At power off the most recent records
+   are dumped over the serial port, and utils/trace-decode turns
+   the dump into a timeline. */
+
+/* Traced events, and the meaning of their two arguments. */
+enum trace_event {
+	TRACE_SWITCH,               /* Context switch: old tid, new tid. */
+	TRACE_PAGE_FAULT,           /* Page fault: address, TRACE_PF_* flags. */
+	TRACE_DISK_READ,            /* Disk read started: disk, sector. */
+	TRACE_DISK_WRITE,           /* Disk write started: disk, sector. */
+	TRACE_DISK_DONE,            /* Disk read or write done: disk, sector. */
+	TRACE_SYSCALL,              /* System call entry: number, first arg. */
+	TRACE_SYSRET,               /* System call exit: number, return value. */
+	TRACE_PALLOC,               /* Page allocation: page count, address. */
+	TRACE_EVENT_CNT
+};
+
+/* Flags in a TRACE_PAGE_FAULT record. */
+#define TRACE_PF_WRITE 0x1          /* Write access. */
+#define TRACE_PF_USER 0x2           /* Fault in user mode. */
+#define TRACE_PF_NOT_PRESENT 0x4    /* Page not present. */
+
+/* A trace record. */
+struct trace_record {
+	uint64_t tsc;               /* Time stamp counter. */
+	uint32_t event;             /* enum trace_event. */
+	int32_t tid;                /* Running thread. */
+	uint64_t arg0;              /* First argument. */
+	uint64_t arg1;              /* Second argument. */
+};
+
+extern bool trace_enabled;
+
+/* Records EVENT with arguments ARG0 and ARG1, if tracing is on. */
+#define TRACE(EVENT, ARG0, ARG1)                                        \
+	do {                                                                \
+		if (trace_enabled)                                              \
+			trace_event ((EVENT), (uint64_t) (ARG0), (uint64_t) (ARG1)); \
+	} while (0)
+
+void trace_init (void);
+void trace_event (enum trace_event, uint64_t arg0, uint64_t arg1);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
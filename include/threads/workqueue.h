@@ -0,0 +1,67 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Kernel work queue.
+
+   Work that does not have to finish before the current operation
+   returns, such as writing data back to disk or freeing on-disk
+   structures, can be handed to a small pool of kernel worker
+   threads instead of being done on the caller's thread.
+
+   To defer work, embed a struct work in an object that describes
+   it, set it up with work_init(), and pass it to work_queue().  A
+   worker thread later calls the work function with a pointer to
+   the struct work, from which the function recovers the object
+   with work_entry().  Once the function has been called the work
+   belongs to it, so it may free the object.
+
+   Because of that, a finished item cannot be waited for by itself.
+   Code that has to wait for some of its own work, but not for
+   everybody else's, queues it with work_queue_group() and waits
+   with work_group_wait(). */
+
+struct work;
+
+/* Performs the work described by WORK. */
+typedef void work_func (struct work *work);
+
+/* A set of work items that can be waited for together. */
+struct work_group {
+	int pending;                /* # of items queued but not finished. */
+	struct condition done;      /* Signaled when PENDING drops to 0. */
+};
+
+/* A unit of deferred work. */
+struct work {
+	struct list_elem elem;      /* Element in the work queue. */
+	work_func *func;            /* Function that performs the work. */
+	struct work_group *group;   /* Group it was queued in, or null. */
+	int64_t queued_tick;        /* Timer tick at which it was queued. */
+	bool pending;               /* Queued but not yet started? */
+};
+
+/* Converts pointer to work WORK into a pointer to the structure
+   that WORK is embedded inside.  Supply the name of the outer
+   structure STRUCT and the member name MEMBER of the work. */
+#define work_entry(WORK, STRUCT, MEMBER)                        \
+	((STRUCT *) ((uint8_t *) (WORK) - offsetof (STRUCT, MEMBER)))
+
+void workqueue_init (void);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *);
+bool work_queue (struct work *);
+bool work_queue_group (struct work *, struct work_group *);
+bool work_cancel (struct work *);
+void work_flush (void);
+
+void work_group_init (struct work_group *);
+void work_group_wait (struct work_group *);
+
+#endif /* threads/workqueue.h */
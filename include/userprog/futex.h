@@ -0,0 +1,13 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+/* Results of futex_wait() other than waking up.  They match the
+   values that user programs see in lib/user/syscall.h. */
+#define FUTEX_CHANGED (-1)      /* Value differed, or bad address. */
+#define FUTEX_AGAIN (-2)        /* Nothing could ever wake us. */
+
+void futex_init (void);
+int futex_wait (int *uaddr, int expected);
+int futex_wake (int *uaddr, int n);
+
+#endif /* userprog/futex.h */
@@ -3,6 +3,7 @@
 
 #include "threads/thread.h"
 
+void process_table_init (void);
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
@@ -11,8 +12,6 @@ void process_exit (void);
 void process_activate (struct thread *next);
 
 // my functions
-struct thread *get_child_process(tid_t);
-void remove_child_process(struct thread *);
 int process_exec2 (void *);
 
 
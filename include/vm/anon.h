@@ -5,7 +5,10 @@
 struct page;
 enum vm_type;
 
+struct swap_write;
+
 struct anon_page {
+    struct swap_write *swap_write;  /* Write to swap still queued, if any. */
 };
 
 void vm_anon_init (void);
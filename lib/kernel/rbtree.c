@@ -0,0 +1,311 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms follow
+   Cormen, Leiserson, Rivest and Stein, "Introduction to
+   Algorithms", chapter 13, except that missing children are
+   represented by null pointers instead of a sentinel node. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static bool is_red (const struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new);
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+		struct rb_elem *parent);
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) {
+	ASSERT (tree != NULL);
+	ASSERT (less != NULL);
+
+	tree->root = NULL;
+	tree->min = NULL;
+	tree->elem_cnt = 0;
+	tree->less = less;
+	tree->aux = aux;
+}
+
+/* Inserts NEW into TREE.  NEW is placed after any elements
+   already in TREE that compare equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *new) {
+	struct rb_elem **link = &tree->root;
+	struct rb_elem *parent = NULL;
+	bool leftmost = true;
+
+	ASSERT (tree != NULL);
+	ASSERT (new != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (tree->less (new, parent, tree->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	new->parent = parent;
+	new->left = new->right = NULL;
+	new->red = true;
+	*link = new;
+	if (leftmost)
+		tree->min = new;
+	tree->elem_cnt++;
+
+	insert_fixup (tree, new);
+}
+
+/* Removes ELEM, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *elem) {
+	struct rb_elem *child, *parent;
+	bool removed_red;
+
+	ASSERT (tree != NULL);
+	ASSERT (elem != NULL);
+	ASSERT (tree->elem_cnt > 0);
+
+	if (tree->min == elem)
+		tree->min = rb_next (elem);
+
+	if (elem->left == NULL || elem->right == NULL) {
+		/* At most one child: splice ELEM out directly. */
+		child = elem->left != NULL ? elem->left : elem->right;
+		parent = elem->parent;
+		removed_red = elem->red;
+		replace_child (tree, parent, elem, child);
+		if (child != NULL)
+			child->parent = parent;
+	} else {
+		/* Two children: move ELEM's successor, which has no left
+		   child, into ELEM's place. */
+		struct rb_elem *succ = elem->right;
+		while (succ->left != NULL)
+			succ = succ->left;
+
+		removed_red = succ->red;
+		child = succ->right;
+		if (succ->parent == elem)
+			parent = succ;
+		else {
+			parent = succ->parent;
+			replace_child (tree, parent, succ, child);
+			if (child != NULL)
+				child->parent = parent;
+			succ->right = elem->right;
+			succ->right->parent = succ;
+		}
+
+		replace_child (tree, elem->parent, elem, succ);
+		succ->parent = elem->parent;
+		succ->left = elem->left;
+		succ->left->parent = succ;
+		succ->red = elem->red;
+	}
+	tree->elem_cnt--;
+
+	if (!removed_red)
+		remove_fixup (tree, child, parent);
+}
+
+/* Returns the least element in TREE, or a null pointer if TREE
+   is empty. */
+struct rb_elem *
+rb_min (const struct rb_tree *tree) {
+	return tree->min;
+}
+
+/* Returns the element that follows ELEM in its tree, or a null
+   pointer if ELEM is the greatest element. */
+struct rb_elem *
+rb_next (const struct rb_elem *elem) {
+	if (elem->right != NULL) {
+		elem = elem->right;
+		while (elem->left != NULL)
+			elem = elem->left;
+		return (struct rb_elem *) elem;
+	}
+
+	while (elem->parent != NULL && elem == elem->parent->right)
+		elem = elem->parent;
+	return elem->parent;
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rb_tree *tree) {
+	return tree->elem_cnt;
+}
+
+/* Returns true if TREE contains no elements, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) {
+	return tree->elem_cnt == 0;
+}
+
+/* Returns true if ELEM is red.  Null children count as black. */
+static bool
+is_red (const struct rb_elem *elem) {
+	return elem != NULL && elem->red;
+}
+
+/* Makes NEW take the place of OLD as a child of PARENT, or as
+   the root of TREE if PARENT is null. */
+static void
+replace_child (struct rb_tree *tree, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new) {
+	if (parent == NULL)
+		tree->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's right
+   child takes its place. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, so that X's left
+   child takes its place. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	replace_child (tree, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black properties after red element ELEM has
+   been inserted into TREE. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *elem) {
+	struct rb_elem *parent;
+
+	while ((parent = elem->parent) != NULL && parent->red) {
+		/* PARENT is red, so it is not the root. */
+		struct rb_elem *grand = parent->parent;
+
+		if (parent == grand->left) {
+			struct rb_elem *uncle = grand->right;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grand->red = true;
+				elem = grand;
+				continue;
+			}
+			if (elem == parent->right) {
+				rotate_left (tree, parent);
+				elem = parent;
+				parent = elem->parent;
+			}
+			parent->red = false;
+			grand->red = true;
+			rotate_right (tree, grand);
+		} else {
+			struct rb_elem *uncle = grand->left;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grand->red = true;
+				elem = grand;
+				continue;
+			}
+			if (elem == parent->left) {
+				rotate_right (tree, parent);
+				elem = parent;
+				parent = elem->parent;
+			}
+			parent->red = false;
+			grand->red = true;
+			rotate_left (tree, grand);
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black element has
+   been removed from TREE.  ELEM, which may be null, is the
+   element that took the removed element's place, and PARENT is
+   its parent. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *elem,
+		struct rb_elem *parent) {
+	while (elem != tree->root && !is_red (elem)) {
+		if (elem == parent->left) {
+			struct rb_elem *sib = parent->right;
+			if (sib->red) {
+				sib->red = false;
+				parent->red = true;
+				rotate_left (tree, parent);
+				sib = parent->right;
+			}
+			if (!is_red (sib->left) && !is_red (sib->right)) {
+				sib->red = true;
+				elem = parent;
+				parent = elem->parent;
+				continue;
+			}
+			if (!is_red (sib->right)) {
+				sib->left->red = false;
+				sib->red = true;
+				rotate_right (tree, sib);
+				sib = parent->right;
+			}
+			sib->red = parent->red;
+			parent->red = false;
+			sib->right->red = false;
+			rotate_left (tree, parent);
+		} else {
+			struct rb_elem *sib = parent->left;
+			if (sib->red) {
+				sib->red = false;
+				parent->red = true;
+				rotate_right (tree, parent);
+				sib = parent->left;
+			}
+			if (!is_red (sib->left) && !is_red (sib->right)) {
+				sib->red = true;
+				elem = parent;
+				parent = elem->parent;
+				continue;
+			}
+			if (!is_red (sib->left)) {
+				sib->right->red = false;
+				sib->red = true;
+				rotate_left (tree, sib);
+				sib = parent->left;
+			}
+			sib->red = parent->red;
+			parent->red = false;
+			sib->left->red = false;
+			rotate_right (tree, parent);
+		}
+		elem = tree->root;
+	}
+	if (elem != NULL)
+		elem->red = false;
+}
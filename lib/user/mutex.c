@@ -0,0 +1,59 @@
+#include <mutex.h>
+#include <debug.h>
+#include <syscall.h>
+
+/* Mutex states. */
+#define UNLOCKED 0              /* Not held. */
+#define LOCKED 1                /* Held, nobody sleeping. */
+#define CONTENDED 2             /* Held, somebody may be sleeping. */
+
+/* If *P equals OLD, sets it to NEW.  Returns the previous value
+   of *P either way. */
+static inline int
+cmpxchg (int *p, int old, int new) {
+	__atomic_compare_exchange_n (p, &old, new, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	return old;
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m) {
+	m->state = UNLOCKED;
+}
+
+/* Acquires M, sleeping until it is available if necessary. */
+void
+mutex_lock (struct mutex *m) {
+	int c = cmpxchg (&m->state, UNLOCKED, LOCKED);
+
+	if (c == UNLOCKED)
+		return;
+
+	/* Mark M contended so that its holder wakes us, then sleep
+	   until we find it unlocked.  We take it in the contended
+	   state, since others may still be sleeping. */
+	if (c != CONTENDED)
+		c = __atomic_exchange_n (&m->state, CONTENDED, __ATOMIC_ACQUIRE);
+	while (c != UNLOCKED) {
+		/* With no other thread to unlock M, we already hold it. */
+		if (futex_wait (&m->state, CONTENDED) == FUTEX_AGAIN)
+			PANIC ("mutex_lock: deadlock on mutex already held");
+		c = __atomic_exchange_n (&m->state, CONTENDED, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Tries to acquire M without sleeping.  Returns nonzero if
+   successful, zero if M is held. */
+int
+mutex_trylock (struct mutex *m) {
+	return cmpxchg (&m->state, UNLOCKED, LOCKED) == UNLOCKED;
+}
+
+/* Releases M, which the caller must hold, waking up one sleeper
+   if there may be any. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_exchange_n (&m->state, UNLOCKED, __ATOMIC_RELEASE) == CONTENDED)
+		futex_wake (&m->state, 1);
+}
@@ -194,3 +194,13 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+futex_wait (int *addr, int expected) {
+	return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int n) {
+	return syscall2 (SYS_FUTEX_WAKE, addr, n);
+}
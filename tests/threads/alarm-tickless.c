@@ -0,0 +1,40 @@
+/* Sleeps for a second with nothing else to run, so that the idle
+   thread may stop the timer tick, and checks that the tick count
+   still wakes the thread up on exactly the right tick and stays
+   in step with the time stamp counter. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_TICKS TIMER_FREQ
+
+void
+test_alarm_tickless (void)
+{
+  int64_t start_tick, start_ns, ticks, ns, expect_ns;
+
+  /* Start sleeping right after a tick. */
+  start_tick = timer_ticks ();
+  while (timer_ticks () == start_tick)
+    continue;
+
+  start_tick = timer_ticks ();
+  start_ns = timer_ns ();
+  timer_sleep (SLEEP_TICKS);
+  ticks = timer_elapsed (start_tick);
+  ns = timer_ns () - start_ns;
+
+  if (ticks != SLEEP_TICKS)
+    fail ("woke up after %lld ticks, not %d", (long long) ticks, SLEEP_TICKS);
+  msg ("woke up after %d ticks.", SLEEP_TICKS);
+
+  /* Allow two ticks either way for interrupt latency. */
+  expect_ns = (int64_t) SLEEP_TICKS * 1000000000 / TIMER_FREQ;
+  if (ns < expect_ns - 2 * 1000000000 / TIMER_FREQ
+      || ns > expect_ns + 2 * 1000000000 / TIMER_FREQ)
+    fail ("%d ticks took %lld ns", SLEEP_TICKS, (long long) ns);
+  msg ("tick count kept time.");
+}
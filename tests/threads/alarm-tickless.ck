@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) woke up after 100 ticks.
+(alarm-tickless) tick count kept time.
+(alarm-tickless) end
+EOF
+pass;
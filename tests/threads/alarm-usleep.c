@@ -0,0 +1,66 @@
+/* Checks that sub-tick sleeps with timer_usleep() are neither
+   early nor much late, and that they block instead of spinning:
+   a lower-priority thread that only runs while the main thread is
+   off the CPU must make progress during them. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20                    /* Number of sleeps. */
+#define SLEEP_US 500                    /* Length of each sleep. */
+#define SLACK_NS (100 * 1000 * 1000)    /* Allowed total lateness. */
+
+static volatile bool done;
+static volatile long long spins;
+
+static thread_func spinner;
+
+void
+test_alarm_usleep (void)
+{
+  struct semaphore finished;
+  int64_t start, before;
+  long long spins_before;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&finished, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, &finished);
+
+  spins_before = spins;
+  start = timer_ns ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      before = timer_ns ();
+      timer_usleep (SLEEP_US);
+      if (timer_ns () - before < SLEEP_US * 1000)
+        fail ("sleep %d woke up early, after %lld ns",
+              i, (long long) (timer_ns () - before));
+    }
+  if (timer_ns () - start > SLEEP_CNT * SLEEP_US * 1000 + SLACK_NS)
+    fail ("%d sleeps of %d us took %lld ns", SLEEP_CNT, SLEEP_US,
+          (long long) (timer_ns () - start));
+  msg ("%d sleeps of %d us on time.", SLEEP_CNT, SLEEP_US);
+  if (spins == spins_before)
+    fail ("lower-priority thread never ran while sleeping");
+  msg ("lower-priority thread ran while sleeping.");
+
+  done = true;
+  sema_down (&finished);
+}
+
+static void
+spinner (void *finished_)
+{
+  struct semaphore *finished = finished_;
+
+  while (!done)
+    spins++;
+  sema_up (finished);
+}
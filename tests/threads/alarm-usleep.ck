@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) 20 sleeps of 500 us on time.
+(alarm-usleep) lower-priority thread ran while sleeping.
+(alarm-usleep) end
+EOF
+pass;
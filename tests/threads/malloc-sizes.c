@@ -0,0 +1,67 @@
+/* Allocates blocks across every kind of malloc() size class: the
+   8-byte steps, the quarter-power steps, the classes that fit two
+   or three blocks to a page, and big blocks.  Fills each block
+   completely and checks that no block overwrote another, then
+   checks that realloc() keeps a block's contents as it moves
+   between classes. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+
+#define PER_SIZE 12                     /* Blocks of each size. */
+
+static const size_t sizes[] =
+  {
+    1, 8, 9, 17, 100, 128, 129, 150, 200, 257, 700, 1000, 1024,
+    1025, 1300, 1400, 2000, 2032, 2033, 3000, 5000,
+  };
+#define SIZE_CNT (sizeof sizes / sizeof *sizes)
+
+static uint8_t *blocks[SIZE_CNT][PER_SIZE];
+
+void
+test_malloc_sizes (void)
+{
+  size_t i, j, k;
+  uint8_t *p;
+
+  for (i = 0; i < SIZE_CNT; i++)
+    for (j = 0; j < PER_SIZE; j++)
+      {
+        blocks[i][j] = malloc (sizes[i]);
+        if (blocks[i][j] == NULL)
+          fail ("malloc (%zu) failed", sizes[i]);
+        if ((uintptr_t) blocks[i][j] % 8 != 0)
+          fail ("malloc (%zu) returned misaligned %p",
+                sizes[i], blocks[i][j]);
+        memset (blocks[i][j], i * PER_SIZE + j, sizes[i]);
+      }
+
+  for (i = 0; i < SIZE_CNT; i++)
+    for (j = 0; j < PER_SIZE; j++)
+      for (k = 0; k < sizes[i]; k++)
+        if (blocks[i][j][k] != (uint8_t) (i * PER_SIZE + j))
+          fail ("byte %zu of block %zu of size %zu was overwritten",
+                k, j, sizes[i]);
+  msg ("%d blocks of each of %d sizes kept their contents.",
+       PER_SIZE, (int) SIZE_CNT);
+
+  for (i = 0; i < SIZE_CNT; i++)
+    for (j = 0; j < PER_SIZE; j++)
+      free (blocks[i][j]);
+
+  p = malloc (1);
+  p[0] = 0x5a;
+  for (i = 0; i < SIZE_CNT; i++)
+    {
+      p = realloc (p, sizes[i]);
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed", sizes[i]);
+      if (p[0] != 0x5a)
+        fail ("realloc to %zu bytes lost the contents", sizes[i]);
+    }
+  free (p);
+  msg ("realloc kept the contents through every size.");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-sizes) begin
+(malloc-sizes) 12 blocks of each of 21 sizes kept their contents.
+(malloc-sizes) realloc kept the contents through every size.
+(malloc-sizes) end
+EOF
+pass;
@@ -0,0 +1,110 @@
+/* Measures how much time the timer interrupt takes under the
+   4.4BSD scheduler when there are many threads.
+
+   The main thread counts the loop iterations it completes in a
+   fixed number of ticks, first alone and then with THREAD_CNT
+   extra threads that have each accumulated some recent_cpu and
+   then blocked.  Whatever the timer interrupt spends on
+   scheduler bookkeeping is lost to the loop, so the difference
+   between the two counts is the added per-tick overhead.  Only
+   the once-per-second recent_cpu decay needs to visit blocked
+   threads, so the difference should be small. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 500
+#define MEASURE_TICKS (2 * TIMER_FREQ)
+
+struct tick_test
+  {
+    struct semaphore blocked;   /* Upped by each thread before it blocks. */
+    struct semaphore release;   /* Downed by each thread to block. */
+    struct semaphore done;      /* Upped by each thread as it exits. */
+  };
+
+static thread_func spin_then_block;
+static int64_t count_loops (void);
+
+void
+test_mlfqs_tick_cost (void)
+{
+  struct tick_test test;
+  int64_t alone, loaded;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&test.blocked, 0);
+  sema_init (&test.release, 0);
+  sema_init (&test.done, 0);
+
+  msg ("Counting loops for %d ticks with no other threads...",
+       MEASURE_TICKS);
+  alone = count_loops ();
+
+  msg ("Starting %d threads that spin briefly and then block...",
+       THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "%d", i);
+      if (thread_create (name, PRI_DEFAULT, spin_then_block, &test)
+          == TID_ERROR)
+        fail ("thread_create failed for thread %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.blocked);
+
+  msg ("Counting loops for %d ticks with %d blocked threads...",
+       MEASURE_TICKS, THREAD_CNT);
+  loaded = count_loops ();
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&test.release);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+
+  msg ("alone: %lld loops/tick, with %d threads: %lld loops/tick.",
+       alone / MEASURE_TICKS, THREAD_CNT, loaded / MEASURE_TICKS);
+  if (loaded < alone)
+    msg ("timer interrupt overhead: %lld.%02lld%% of each tick.",
+         (alone - loaded) * 100 / alone,
+         (alone - loaded) * 10000 / alone % 100);
+  else
+    msg ("timer interrupt overhead: 0.00%% of each tick.");
+  pass ();
+}
+
+/* Spins for MEASURE_TICKS ticks, starting at a tick boundary, and
+   returns the number of loop iterations completed. */
+static int64_t
+count_loops (void)
+{
+  int64_t start = timer_ticks ();
+  int64_t loops = 0;
+
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  while (timer_elapsed (start) < MEASURE_TICKS)
+    loops++;
+  return loops;
+}
+
+static void
+spin_then_block (void *test_)
+{
+  struct tick_test *test = test_;
+  int64_t start = timer_ticks ();
+
+  while (timer_ticks () == start)
+    continue;
+  sema_up (&test->blocked);
+  sema_down (&test->release);
+  sema_up (&test->done);
+}
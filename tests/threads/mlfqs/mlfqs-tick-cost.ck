@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing loop counts in output"
+  unless grep (/^\(mlfqs-tick-cost\) alone: \d+ loops\/tick, with 500 threads: \d+ loops\/tick\.$/,
+	       @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(mlfqs-tick-cost) PASS', @output);
+
+pass;
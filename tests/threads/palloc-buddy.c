@@ -0,0 +1,79 @@
+/* Exercises the buddy page allocator.  Allocates blocks of mixed
+   sizes, most of which are not powers of two, tags every page,
+   and frees them in a scrambled order, several times over.  No
+   two blocks may overlap, so every tag has to survive until its
+   block is freed.  Afterward, a large block has to be available
+   again, which needs the freed pieces to have been merged. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define ROUND_CNT 8                     /* Rounds of allocation. */
+#define BLOCK_CNT 24                    /* Blocks per round. */
+#define MAX_PAGES 16                    /* Largest block, in pages. */
+#define BIG_PAGES 256                   /* Block needed at the end. */
+
+static unsigned seed = 1;
+
+/* Returns a pseudo-random number in [0, N). */
+static unsigned
+pick (unsigned n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+void
+test_palloc_buddy (void)
+{
+  uint8_t *blocks[BLOCK_CNT];
+  size_t sizes[BLOCK_CNT];
+  int order[BLOCK_CNT];
+  uint8_t *big;
+  size_t i, j;
+  int round;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      for (i = 0; i < BLOCK_CNT; i++)
+        {
+          sizes[i] = pick (MAX_PAGES) + 1;
+          blocks[i] = palloc_get_multiple (0, sizes[i]);
+          if (blocks[i] == NULL)
+            fail ("round %d: allocating %zu pages failed", round, sizes[i]);
+          if (pg_ofs (blocks[i]) != 0)
+            fail ("round %d: block %p is not page-aligned", round, blocks[i]);
+          for (j = 0; j < sizes[i]; j++)
+            *(size_t *) (blocks[i] + j * PGSIZE) = i * MAX_PAGES + j;
+          order[i] = i;
+        }
+
+      for (i = 0; i < BLOCK_CNT; i++)
+        for (j = 0; j < sizes[i]; j++)
+          if (*(size_t *) (blocks[i] + j * PGSIZE) != i * MAX_PAGES + j)
+            fail ("round %d: page %zu of block %zu was overwritten",
+                  round, j, i);
+
+      for (i = BLOCK_CNT - 1; i > 0; i--)
+        {
+          int k = pick (i + 1);
+          int t = order[i];
+          order[i] = order[k];
+          order[k] = t;
+        }
+      for (i = 0; i < BLOCK_CNT; i++)
+        palloc_free_multiple (blocks[order[i]], sizes[order[i]]);
+    }
+  msg ("%d rounds of %d blocks without overlap.", ROUND_CNT, BLOCK_CNT);
+
+  big = palloc_get_multiple (PAL_ZERO, BIG_PAGES);
+  if (big == NULL)
+    fail ("allocating %d pages after freeing everything failed", BIG_PAGES);
+  for (i = 0; i < BIG_PAGES * PGSIZE; i++)
+    if (big[i] != 0)
+      fail ("byte %zu of zeroed block is %d", i, big[i]);
+  palloc_free_multiple (big, BIG_PAGES);
+  msg ("%d-page zeroed block available afterward.", BIG_PAGES);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) 8 rounds of 24 blocks without overlap.
+(palloc-buddy) 256-page zeroed block available afterward.
+(palloc-buddy) end
+EOF
+pass;
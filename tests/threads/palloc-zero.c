@@ -0,0 +1,43 @@
+/* Checks that PAL_ZERO pages are zero whether they come from the
+   stock zeroed while idle or are cleared on demand.  Repeatedly
+   takes more zeroed pages than the stock holds, scribbles over
+   them, and frees them, sleeping between rounds so that the idle
+   thread can refill the stock. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 4                     /* Rounds of allocation. */
+#define PAGE_CNT 100                    /* Pages per round. */
+
+static uint8_t *pages[PAGE_CNT];
+
+void
+test_palloc_zero (void)
+{
+  int round, i;
+  size_t j;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      timer_msleep (100);
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          pages[i] = palloc_get_page (PAL_ZERO);
+          if (pages[i] == NULL)
+            fail ("round %d: allocating page %d failed", round, i);
+          for (j = 0; j < PGSIZE; j++)
+            if (pages[i][j] != 0)
+              fail ("round %d: byte %zu of page %d is %d",
+                    round, j, i, pages[i][j]);
+          memset (pages[i], 0xa5, PGSIZE);
+        }
+      for (i = 0; i < PAGE_CNT; i++)
+        palloc_free_page (pages[i]);
+    }
+  msg ("%d rounds of %d zeroed pages were all zero.", ROUND_CNT, PAGE_CNT);
+}
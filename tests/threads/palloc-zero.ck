@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) 4 rounds of 100 zeroed pages were all zero.
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* A thread waiting on a condition variable receives a priority
+   donation through a lock it still holds.  Checks that
+   cond_signal() takes the donation into account and wakes it up
+   before a thread that started waiting earlier with a priority
+   that is higher than its own base priority, but lower than the
+   donated one. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func low_thread;
+static thread_func mid_thread;
+static thread_func high_thread;
+
+static struct lock monitor;     /* Protects condition. */
+static struct condition condition;
+static struct lock held;        /* Held by "low" while it waits. */
+
+void
+test_priority_donate_condvar (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&monitor);
+  cond_init (&condition);
+  lock_init (&held);
+
+  /* Each of these runs until it blocks, because it has a higher
+     priority than the main thread. */
+  thread_create ("mid", PRI_DEFAULT + 2, mid_thread, NULL);
+  thread_create ("low", PRI_DEFAULT + 1, low_thread, NULL);
+  thread_create ("high", PRI_DEFAULT + 3, high_thread, NULL);
+
+  msg ("Signaling...");
+  lock_acquire (&monitor);
+  cond_signal (&condition, &monitor);
+  lock_release (&monitor);
+
+  msg ("Signaling...");
+  lock_acquire (&monitor);
+  cond_signal (&condition, &monitor);
+  lock_release (&monitor);
+}
+
+static void
+mid_thread (void *aux UNUSED)
+{
+  lock_acquire (&monitor);
+  cond_wait (&condition, &monitor);
+  msg ("Thread mid woke up.");
+  lock_release (&monitor);
+}
+
+static void
+low_thread (void *aux UNUSED)
+{
+  lock_acquire (&held);
+  lock_acquire (&monitor);
+  cond_wait (&condition, &monitor);
+  msg ("Thread low woke up with priority %d.", thread_get_priority ());
+  lock_release (&monitor);
+  lock_release (&held);
+}
+
+static void
+high_thread (void *aux UNUSED)
+{
+  lock_acquire (&held);
+  msg ("Thread high got the lock.");
+  lock_release (&held);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-condvar) begin
+(priority-donate-condvar) Signaling...
+(priority-donate-condvar) Thread low woke up with priority 34.
+(priority-donate-condvar) Thread high got the lock.
+(priority-donate-condvar) Signaling...
+(priority-donate-condvar) Thread mid woke up.
+(priority-donate-condvar) end
+EOF
+pass;
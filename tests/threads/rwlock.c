@@ -0,0 +1,95 @@
+/* Checks read-write locks.
+
+   First, several readers each hold the same lock for reading
+   while they sleep, the way syn-read's children all read one
+   file at once, and the test checks that they were all inside
+   together.
+
+   Then the main thread holds the lock for reading while a
+   higher-priority writer arrives, checks that the writer donates
+   its priority to the main thread, and that a still
+   higher-priority reader arriving after the writer neither gets
+   in ahead of it nor fails to donate to the main thread through
+   it.  Once the main thread lets go, the writer should run
+   before the late reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 5                    /* Concurrent readers. */
+#define READ_TICKS 10                   /* Ticks each reader sleeps. */
+
+static struct rwlock rw;
+static int inside;                      /* Readers holding RW. */
+static int max_inside;                  /* Most readers holding RW. */
+
+static thread_func sleepy_reader;
+static thread_func writer;
+static thread_func late_reader;
+
+void
+test_rwlock (void)
+{
+  struct semaphore done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&rw);
+  sema_init (&done, 0);
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, sleepy_reader, &done);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&done);
+  msg ("%d readers inside at once.", max_inside);
+
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 1, writer, NULL);
+  msg ("main priority %d while writer waits.", thread_get_priority ());
+  thread_create ("late reader", PRI_DEFAULT + 2, late_reader, NULL);
+  msg ("main priority %d while late reader waits.", thread_get_priority ());
+  rwlock_release_read (&rw);
+  msg ("main priority %d.", thread_get_priority ());
+}
+
+static void
+sleepy_reader (void *done_)
+{
+  struct semaphore *done = done_;
+
+  rwlock_acquire_read (&rw);
+  if (++inside > max_inside)
+    max_inside = inside;
+  timer_sleep (READ_TICKS);
+  inside--;
+  rwlock_release_read (&rw);
+  sema_up (done);
+}
+
+static void
+writer (void *aux UNUSED)
+{
+  rwlock_acquire_write (&rw);
+  msg ("writer got the lock.");
+  rwlock_release_write (&rw);
+  msg ("writer done.");
+}
+
+static void
+late_reader (void *aux UNUSED)
+{
+  rwlock_acquire_read (&rw);
+  msg ("late reader got the lock.");
+  rwlock_release_read (&rw);
+  msg ("late reader done.");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock) begin
+(rwlock) 5 readers inside at once.
+(rwlock) main priority 32 while writer waits.
+(rwlock) main priority 33 while late reader waits.
+(rwlock) writer got the lock.
+(rwlock) late reader got the lock.
+(rwlock) late reader done.
+(rwlock) writer done.
+(rwlock) main priority 31.
+(rwlock) end
+EOF
+pass;
@@ -0,0 +1,94 @@
+/* Runs two periodic earliest-deadline-first threads whose total
+   utilization is within the admission limit, checks that a third
+   reservation that would overload the CPU is rejected, and checks
+   that the two admitted threads never miss a deadline even though
+   the main thread competes with them for the CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 10                      /* Periods to run each thread. */
+
+struct edf_thread
+  {
+    int64_t period;             /* Period, in ticks. */
+    int64_t budget;             /* Budget per period, in ticks. */
+    int64_t work;               /* Ticks of work done per period. */
+    bool admitted;              /* Result of thread_set_period(). */
+    unsigned missed;            /* Deadlines missed. */
+    struct semaphore *started;  /* Upped once admitted or rejected. */
+    struct semaphore *done;     /* Upped when finished. */
+  };
+
+static thread_func edf_thread;
+
+void
+test_sched_edf (void)
+{
+  struct edf_thread threads[2] = {
+    {.period = 10, .budget = 3, .work = 2},
+    {.period = 20, .budget = 6, .work = 4},
+  };
+  struct semaphore started, done;
+  int64_t end;
+  int i;
+
+  sema_init (&started, 0);
+  sema_init (&done, 0);
+  for (i = 0; i < 2; i++)
+    {
+      char name[16];
+
+      threads[i].started = &started;
+      threads[i].done = &done;
+      snprintf (name, sizeof name, "edf %d", i);
+      thread_create (name, PRI_DEFAULT, edf_thread, &threads[i]);
+      sema_down (&started);
+      msg ("period %lld, budget %lld: %s.",
+           threads[i].period, threads[i].budget,
+           threads[i].admitted ? "admitted" : "rejected");
+    }
+
+  msg ("period 10, budget 5: %s.",
+       thread_set_period (10, 5) ? "admitted" : "rejected");
+
+  /* Compete for the CPU until both threads are done. */
+  end = timer_ticks () + JOB_CNT * 20;
+  while (timer_ticks () < end)
+    continue;
+
+  for (i = 0; i < 2; i++)
+    sema_down (&done);
+  for (i = 0; i < 2; i++)
+    msg ("edf %d missed %u deadlines.", i, threads[i].missed);
+}
+
+/* Does WORK ticks of work per period for JOB_CNT periods. */
+static void
+edf_thread (void *t_)
+{
+  struct edf_thread *t = t_;
+  struct thread *cur = thread_current ();
+  int i;
+
+  t->admitted = thread_set_period (t->period, t->budget);
+  sema_up (t->started);
+  if (t->admitted)
+    {
+      for (i = 0; i < JOB_CNT; i++)
+        {
+          int64_t start = cur->kernel_ticks;
+
+          while (cur->kernel_ticks - start < t->work)
+            barrier ();
+          thread_wait_period ();
+        }
+      t->missed = cur->rt_missed;
+      thread_set_period (0, 0);
+    }
+  sema_up (t->done);
+}
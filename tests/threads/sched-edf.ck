@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-edf) begin
+(sched-edf) period 10, budget 3: admitted.
+(sched-edf) period 20, budget 6: admitted.
+(sched-edf) period 10, budget 5: rejected.
+(sched-edf) edf 0 missed 0 deadlines.
+(sched-edf) edf 1 missed 0 deadlines.
+(sched-edf) end
+EOF
+pass;
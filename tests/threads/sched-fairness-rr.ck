@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing fairness index in output"
+  unless grep (/^\(sched-fairness-rr\) CPU-bound fairness index: \d+\/1000\.$/,
+	       @output);
+fail "missing sleeper latency in output"
+  unless grep (/^\(sched-fairness-rr\) sleeper wakeup latency: \d+\.\d\d ticks average\.$/,
+	       @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(sched-fairness-rr) PASS', @output);
+
+pass;
@@ -0,0 +1,143 @@
+/* Compares the round-robin scheduler with the completely fair
+   scheduler on a mix of CPU-bound and sleep-heavy threads.
+   sched-fairness-rr runs under the default scheduler and
+   sched-fairness-cfs under "-cfs"; their output is meant to be
+   read side by side.
+
+   Each CPU-bound thread spins for the whole test, counting loop
+   iterations.  Each sleep-heavy thread repeatedly does about a
+   tick of work and then sleeps for a few ticks, noting how late
+   it was woken up.  At the end the test reports Jain's fairness
+   index over the CPU time of the CPU-bound threads (1000 means
+   that every thread got the same share), the throughput of both
+   kinds of thread, and the sleepers' average wakeup latency. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define CPU_CNT 4                       /* CPU-bound threads. */
+#define SLEEPER_CNT 4                   /* Sleep-heavy threads. */
+#define TEST_TICKS (5 * TIMER_FREQ)     /* Length of the test. */
+#define SLEEP_TICKS 3                   /* Sleep between work units. */
+
+struct worker
+  {
+    int64_t end;                /* Tick at which to stop. */
+    struct semaphore *done;     /* Upped when the worker stops. */
+    int64_t iterations;         /* Loop iterations completed. */
+    int64_t cpu_ticks;          /* Ticks charged to a CPU-bound worker. */
+    int64_t wakeups;            /* Number of sleeps. */
+    int64_t late_ticks;         /* Total ticks woken up late. */
+  };
+
+static thread_func cpu_bound;
+static thread_func sleeper;
+static void measure (void);
+
+void
+test_sched_fairness_rr (void)
+{
+  ASSERT (!thread_mlfqs && !thread_cfs);
+  measure ();
+}
+
+void
+test_sched_fairness_cfs (void)
+{
+  ASSERT (thread_cfs);
+  measure ();
+}
+
+static void
+measure (void)
+{
+  struct worker cpus[CPU_CNT], sleepers[SLEEPER_CNT];
+  struct semaphore done;
+  int64_t end, sum, sum_sq, cpu_iterations, sleeper_iterations;
+  int64_t wakeups, late_ticks;
+  int i;
+
+  sema_init (&done, 0);
+  end = timer_ticks () + TEST_TICKS;
+  for (i = 0; i < CPU_CNT + SLEEPER_CNT; i++)
+    {
+      bool is_cpu = i < CPU_CNT;
+      struct worker *w = is_cpu ? &cpus[i] : &sleepers[i - CPU_CNT];
+      char name[16];
+
+      w->end = end;
+      w->done = &done;
+      w->iterations = w->cpu_ticks = w->wakeups = w->late_ticks = 0;
+      snprintf (name, sizeof name, is_cpu ? "cpu %d" : "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, is_cpu ? cpu_bound : sleeper, w);
+    }
+  for (i = 0; i < CPU_CNT + SLEEPER_CNT; i++)
+    sema_down (&done);
+
+  sum = sum_sq = cpu_iterations = 0;
+  for (i = 0; i < CPU_CNT; i++)
+    {
+      msg ("cpu %d: %lld ticks, %lld iterations.",
+           i, cpus[i].cpu_ticks, cpus[i].iterations);
+      sum += cpus[i].cpu_ticks;
+      sum_sq += cpus[i].cpu_ticks * cpus[i].cpu_ticks;
+      cpu_iterations += cpus[i].iterations;
+    }
+  sleeper_iterations = wakeups = late_ticks = 0;
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      sleeper_iterations += sleepers[i].iterations;
+      wakeups += sleepers[i].wakeups;
+      late_ticks += sleepers[i].late_ticks;
+    }
+
+  msg ("scheduler: %s.", thread_cfs ? "cfs" : "round-robin");
+  msg ("CPU-bound fairness index: %lld/1000.",
+       sum_sq > 0 ? sum * sum * 1000 / (CPU_CNT * sum_sq) : 1000);
+  msg ("CPU-bound throughput: %lld iterations.", cpu_iterations);
+  msg ("sleeper throughput: %lld iterations.", sleeper_iterations);
+  msg ("sleeper wakeup latency: %lld.%02lld ticks average.",
+       late_ticks / (wakeups ? wakeups : 1),
+       late_ticks * 100 / (wakeups ? wakeups : 1) % 100);
+  pass ();
+}
+
+/* Spins until the end of the test. */
+static void
+cpu_bound (void *w_)
+{
+  struct worker *w = w_;
+  int64_t start = thread_current ()->kernel_ticks;
+
+  while (timer_ticks () < w->end)
+    w->iterations++;
+  w->cpu_ticks = thread_current ()->kernel_ticks - start;
+  sema_up (w->done);
+}
+
+/* Alternates about one tick of work with SLEEP_TICKS of sleep
+   until the end of the test. */
+static void
+sleeper (void *w_)
+{
+  struct worker *w = w_;
+
+  while (timer_ticks () < w->end)
+    {
+      int64_t now = timer_ticks ();
+      int64_t wake;
+
+      while (timer_ticks () == now)
+        w->iterations++;
+
+      wake = timer_ticks () + SLEEP_TICKS;
+      timer_sleep (SLEEP_TICKS);
+      w->late_ticks += timer_ticks () - wake;
+      w->wakeups++;
+    }
+  sema_up (w->done);
+}
@@ -0,0 +1,77 @@
+/* Measures the cost of a context switch as the number of ready
+   threads grows.  For each thread count, the same total number of
+   thread_yield() calls is spread across that many threads, so
+   with an O(1) run queue the elapsed time should stay roughly
+   flat from one line of output to the next. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Total number of yields performed for each thread count. */
+#define YIELD_CNT 20000
+
+struct switch_test
+  {
+    int iterations;             /* Yields per thread. */
+    struct semaphore done;      /* Upped by each finished thread. */
+  };
+
+static thread_func yielder;
+static void measure (int thread_cnt);
+
+void
+test_sched_switch_cost (void)
+{
+  static const int thread_cnts[] = {1, 16, 128, 512};
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < sizeof thread_cnts / sizeof *thread_cnts; i++)
+    measure (thread_cnts[i]);
+  pass ();
+}
+
+/* Runs THREAD_CNT threads that together yield YIELD_CNT times
+   and reports how long it took. */
+static void
+measure (int thread_cnt)
+{
+  struct switch_test test;
+  int64_t start, ticks;
+  int i;
+
+  test.iterations = YIELD_CNT / thread_cnt;
+  sema_init (&test.done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "%d", i);
+      if (thread_create (name, PRI_DEFAULT, yielder, &test) == TID_ERROR)
+        fail ("thread_create failed for thread %d", i);
+    }
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&test.done);
+  ticks = timer_elapsed (start);
+
+  msg ("%d threads: %d switches in %lld ticks.",
+       thread_cnt, test.iterations * thread_cnt, ticks);
+}
+
+static void
+yielder (void *test_)
+{
+  struct switch_test *test = test_;
+  int i;
+
+  for (i = 0; i < test->iterations; i++)
+    thread_yield ();
+  sema_up (&test->done);
+}
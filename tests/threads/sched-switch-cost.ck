@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $cnt (1, 16, 128, 512) {
+    fail "missing measurement for $cnt threads"
+      unless grep (/^\(sched-switch-cost\) $cnt threads: \d+ switches in \d+ ticks\.$/,
+		   @output);
+}
+fail "missing PASS in output"
+  unless grep ($_ eq '(sched-switch-cost) PASS', @output);
+
+pass;
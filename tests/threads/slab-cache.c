@@ -0,0 +1,97 @@
+/* Exercises a slab cache.  Allocates enough objects to fill
+   several slabs, checking that each is aligned, constructed, and
+   distinct from the others, then frees them in a scrambled order
+   and allocates them again, checking that freed objects come back
+   still in their constructed state. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 200                     /* Objects to allocate. */
+#define OBJ_ALIGN 64                    /* Required alignment. */
+#define OBJ_MAGIC 0x0b1ec7              /* Set by the constructor. */
+
+struct obj
+  {
+    unsigned magic;                     /* OBJ_MAGIC while constructed. */
+    int owner;                          /* Index in objs[], or -1. */
+    char payload[100];
+  };
+
+static struct slab_cache cache;
+static struct obj *objs[OBJ_CNT];
+static int ctor_cnt;
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  obj->owner = -1;
+  ctor_cnt++;
+}
+
+/* Allocates every object, checking it and tagging it. */
+static void
+alloc_all (const char *pass)
+{
+  int i, j;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      struct obj *obj = slab_alloc (&cache);
+
+      if (obj == NULL)
+        fail ("%s: allocating object %d failed", pass, i);
+      if ((uintptr_t) obj % OBJ_ALIGN != 0)
+        fail ("%s: object %p is not aligned", pass, obj);
+      if (obj->magic != OBJ_MAGIC || obj->owner != -1)
+        fail ("%s: object %d is not in its constructed state", pass, i);
+      obj->owner = i;
+      memset (obj->payload, i, sizeof obj->payload);
+      objs[i] = obj;
+    }
+
+  for (i = 0; i < OBJ_CNT; i++)
+    for (j = 0; j < (int) sizeof objs[i]->payload; j++)
+      if (objs[i]->owner != i || objs[i]->payload[j] != (char) i)
+        fail ("%s: object %d was overwritten", pass, i);
+}
+
+/* Frees every object, first putting it back in its constructed
+   state. */
+static void
+free_all (void)
+{
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      int k = (i * 37) % OBJ_CNT;
+
+      objs[k]->owner = -1;
+      slab_free (&cache, objs[k]);
+    }
+}
+
+void
+test_slab_cache (void)
+{
+  slab_init (&cache, "test", sizeof (struct obj), OBJ_ALIGN, obj_ctor);
+
+  alloc_all ("first pass");
+  free_all ();
+  msg ("%d objects allocated and freed.", OBJ_CNT);
+
+  alloc_all ("second pass");
+  free_all ();
+  msg ("%d objects reused.", OBJ_CNT);
+
+  if (ctor_cnt % cache.obj_cnt != 0 || ctor_cnt < OBJ_CNT)
+    fail ("constructor ran %d times for %zu objects per slab",
+          ctor_cnt, cache.obj_cnt);
+  msg ("constructor ran once per object in each slab.");
+}
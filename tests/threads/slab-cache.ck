@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) 200 objects allocated and freed.
+(slab-cache) 200 objects reused.
+(slab-cache) constructor ran once per object in each slab.
+(slab-cache) end
+EOF
+pass;
@@ -29,6 +29,20 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"sched-switch-cost", test_sched_switch_cost},
+    {"sched-fairness-rr", test_sched_fairness_rr},
+    {"sched-fairness-cfs", test_sched_fairness_cfs},
+    {"sched-edf", test_sched_edf},
+    {"thread-create-cost", test_thread_create_cost},
+    {"rwlock", test_rwlock},
+    {"alarm-usleep", test_alarm_usleep},
+    {"alarm-tickless", test_alarm_tickless},
+    {"priority-donate-condvar", test_priority_donate_condvar},
+    {"wakeup-latency", test_wakeup_latency},
+    {"palloc-buddy", test_palloc_buddy},
+    {"slab-cache", test_slab_cache},
+    {"malloc-sizes", test_malloc_sizes},
+    {"palloc-zero", test_palloc_zero},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +52,7 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tick-cost", test_mlfqs_tick_cost},
   };
 
 static const char *test_name;
@@ -23,6 +23,20 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_sched_switch_cost;
+extern test_func test_sched_fairness_rr;
+extern test_func test_sched_fairness_cfs;
+extern test_func test_sched_edf;
+extern test_func test_thread_create_cost;
+extern test_func test_rwlock;
+extern test_func test_alarm_usleep;
+extern test_func test_alarm_tickless;
+extern test_func test_priority_donate_condvar;
+extern test_func test_wakeup_latency;
+extern test_func test_palloc_buddy;
+extern test_func test_slab_cache;
+extern test_func test_malloc_sizes;
+extern test_func test_palloc_zero;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +46,7 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tick_cost;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
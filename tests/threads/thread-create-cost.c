@@ -0,0 +1,59 @@
+/* Measures the cost of creating and joining threads.  THREAD_CNT
+   short-lived threads are created first one at a time, each one
+   joined before the next is created, and then in batches of
+   BATCH_SIZE threads that run concurrently.  Each thread does
+   nothing but signal that it has finished, so the elapsed time is
+   dominated by thread_create() and thread_exit(). */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4096
+#define BATCH_SIZE 32
+
+static thread_func signaller;
+static void measure (int batch_size);
+
+void
+test_thread_create_cost (void)
+{
+  measure (1);
+  measure (BATCH_SIZE);
+  pass ();
+}
+
+/* Creates and joins THREAD_CNT threads, BATCH_SIZE at a time, and
+   reports how long it took. */
+static void
+measure (int batch_size)
+{
+  struct semaphore done;
+  int64_t start;
+  int i, j;
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i += batch_size)
+    {
+      for (j = 0; j < batch_size; j++)
+        if (thread_create ("signaller", PRI_DEFAULT, signaller, &done)
+            == TID_ERROR)
+          fail ("thread_create failed for thread %d", i + j);
+      for (j = 0; j < batch_size; j++)
+        sema_down (&done);
+    }
+  msg ("%d threads in batches of %d: %lld ticks.",
+       THREAD_CNT, batch_size, timer_elapsed (start));
+}
+
+static void
+signaller (void *done_)
+{
+  struct semaphore *done = done_;
+
+  sema_up (done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $batch (1, 32) {
+    fail "missing measurement for batches of $batch"
+      unless grep (/^\(thread-create-cost\) 4096 threads in batches of $batch: \d+ ticks\.$/,
+		   @output);
+}
+fail "missing PASS in output"
+  unless grep ($_ eq '(thread-create-cost) PASS', @output);
+
+pass;
@@ -0,0 +1,175 @@
+/* Measures how long a high-priority thread takes to start running
+   after it is woken up, while a lower-priority thread keeps the
+   CPU busy, for the three ways of waking it: thread_create(),
+   sema_up() from a thread, and a timer_sleep() that expires in
+   the timer interrupt.
+
+   With wakeup preemption, the woken thread runs before
+   thread_create() or sema_up() returns, and on the tick it asked
+   for; without it, the woken thread waits for the end of the
+   running thread's time slice, up to TIME_SLICE ticks.  Besides
+   checking that, the test reports the average latency in
+   microseconds from the wakeup to the woken thread running. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 50
+
+static volatile int64_t woken_ns;       /* When the woken thread ran. */
+static volatile bool ran;               /* Has the woken thread run? */
+static volatile bool late;              /* Did a sleeper wake up late? */
+
+static struct semaphore wake;           /* For the sema_up() case. */
+static struct semaphore done;           /* Upped by each helper. */
+
+static thread_func created_thread;
+static thread_func sema_thread;
+static thread_func sleep_thread;
+static void spin_until_ran (void);
+static void report (const char *how, int64_t total_ns);
+
+void
+test_wakeup_latency (void)
+{
+  int64_t total_ns;
+  int missed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&wake, 0);
+  sema_init (&done, 0);
+
+  /* thread_create(). */
+  total_ns = 0;
+  missed = 0;
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t start;
+
+      ran = false;
+      start = timer_ns ();
+      thread_create ("created", PRI_DEFAULT + 1, created_thread, NULL);
+      if (!ran)
+        missed++;
+      spin_until_ran ();
+      total_ns += woken_ns - start;
+      sema_down (&done);
+    }
+  if (missed > 0)
+    fail ("%d of %d created threads did not run before thread_create() "
+          "returned", missed, ITERATIONS);
+  msg ("created threads ran before thread_create() returned.");
+  report ("thread_create", total_ns);
+
+  /* sema_up(). */
+  thread_create ("sema", PRI_DEFAULT + 1, sema_thread, NULL);
+  total_ns = 0;
+  missed = 0;
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t start;
+
+      ran = false;
+      start = timer_ns ();
+      sema_up (&wake);
+      if (!ran)
+        missed++;
+      spin_until_ran ();
+      total_ns += woken_ns - start;
+    }
+  sema_down (&done);
+  if (missed > 0)
+    fail ("%d of %d woken threads did not run before sema_up() returned",
+          missed, ITERATIONS);
+  msg ("woken threads ran before sema_up() returned.");
+  report ("sema_up", total_ns);
+
+  /* timer_sleep(), while this thread spins.  The latency is
+     measured from the last time this thread saw the old tick. */
+  late = false;
+  thread_create ("sleep", PRI_DEFAULT + 1, sleep_thread, NULL);
+  total_ns = 0;
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t tick = timer_ticks ();
+      int64_t before = timer_ns ();
+
+      ran = false;
+      while (!ran)
+        {
+          if (timer_ticks () == tick)
+            before = timer_ns ();
+          else
+            tick = timer_ticks ();
+        }
+      total_ns += woken_ns - before;
+    }
+  sema_down (&done);
+  if (late)
+    fail ("a sleeping thread ran after the tick it asked for");
+  msg ("sleeping threads ran on the tick they asked for.");
+  report ("timer_sleep", total_ns);
+}
+
+static void
+created_thread (void *aux UNUSED)
+{
+  woken_ns = timer_ns ();
+  ran = true;
+  sema_up (&done);
+}
+
+static void
+sema_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      sema_down (&wake);
+      woken_ns = timer_ns ();
+      ran = true;
+    }
+  sema_up (&done);
+}
+
+static void
+sleep_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t wakeup = timer_ticks () + 1;
+
+      timer_sleep (1);
+      woken_ns = timer_ns ();
+      if (timer_ticks () != wakeup)
+        late = true;
+      ran = true;
+    }
+  sema_up (&done);
+}
+
+/* Waits for the woken thread to run, for the case where it did
+   not preempt us. */
+static void
+spin_until_ran (void)
+{
+  while (!ran)
+    continue;
+}
+
+static void
+report (const char *how, int64_t total_ns)
+{
+  msg ("%s: %lld us average wakeup latency.",
+       how, (long long) (total_ns / ITERATIONS / 1000));
+}
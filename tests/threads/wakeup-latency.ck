@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $line ('created threads ran before thread_create() returned.',
+		  'woken threads ran before sema_up() returned.',
+		  'sleeping threads ran on the tick they asked for.') {
+    fail "missing \"$line\""
+      unless grep ($_ eq "(wakeup-latency) $line", @output);
+}
+foreach my $how ('thread_create', 'sema_up', 'timer_sleep') {
+    fail "missing measurement for $how"
+      unless grep (/^\(wakeup-latency\) $how: \d+ us average wakeup latency\.$/,
+		   @output);
+}
+
+pass;
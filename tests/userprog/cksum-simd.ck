@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing \"checksums match\""
+  unless grep ($_ eq "(cksum-simd) checksums match", @output);
+foreach my $what ('scalar', 'sse2') {
+    fail "missing measurement for $what"
+      unless grep (/^\(cksum-simd\) $what: \d+ cycles\/KiB$/, @output);
+}
+fail "missing exit status"
+  unless grep ($_ eq 'cksum-simd: exit(0)', @output);
+
+pass;
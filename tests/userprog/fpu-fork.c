@@ -0,0 +1,75 @@
+/* Checks that a process's SSE registers survive context switches
+   and are inherited by fork().  The parent loads a pattern into
+   %xmm0 and forks.  The child checks that it sees the same
+   pattern and then loads its own.  Both then spin for several
+   time slices, checking that %xmm0 keeps their own pattern while
+   the other process runs. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SPINS 1000000
+
+static void
+load_xmm0 (const uint8_t pattern[16])
+{
+  asm volatile ("movdqu %0, %%xmm0"
+                : : "m" (*(const uint8_t (*)[16]) pattern));
+}
+
+static void
+store_xmm0 (uint8_t pattern[16])
+{
+  asm volatile ("movdqu %%xmm0, %0"
+                : "=m" (*(uint8_t (*)[16]) pattern));
+}
+
+/* Checks %xmm0 against PATTERN SPINS times. */
+static void
+spin (const char *who, const uint8_t pattern[16])
+{
+  uint8_t seen[16];
+  int i;
+
+  for (i = 0; i < SPINS; i++)
+    {
+      store_xmm0 (seen);
+      if (memcmp (seen, pattern, sizeof seen))
+        fail ("%s: %%xmm0 changed after %d checks", who, i);
+    }
+}
+
+void
+test_main (void)
+{
+  uint8_t parent[16], child[16], seen[16];
+  int pid;
+  int i;
+
+  for (i = 0; i < 16; i++)
+    {
+      parent[i] = 0x10 + i;
+      child[i] = 0xf0 - i;
+    }
+
+  load_xmm0 (parent);
+  pid = fork ("child");
+  if (pid)
+    {
+      spin ("parent", parent);
+      msg ("Parent: child exit status is %d", wait (pid));
+      msg ("parent kept its %%xmm0");
+    }
+  else
+    {
+      store_xmm0 (seen);
+      if (memcmp (seen, parent, sizeof seen))
+        fail ("child did not inherit %%xmm0");
+      load_xmm0 (child);
+      spin ("child", child);
+      exit (81);
+    }
+}
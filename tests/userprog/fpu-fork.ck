@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-fork) begin
+child: exit(81)
+(fpu-fork) Parent: child exit status is 81
+(fpu-fork) parent kept its %xmm0
+(fpu-fork) end
+fpu-fork: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+foreach my $line ('futex_wait on changed value',
+		  'futex_wait with nobody to wake it',
+		  'futex_wake with no sleepers',
+		  'trylock unlocked mutex',
+		  'trylock locked mutex') {
+    fail "missing \"$line\""
+      unless grep ($_ eq "(futex-mutex) $line", @output);
+}
+foreach my $what ('uncontended lock/unlock', 'contended unlock',
+		  'futex_wait without sleeping') {
+    fail "missing measurement for $what"
+      unless grep (/^\(futex-mutex\) $what: \d+ cycles$/, @output);
+}
+fail "missing exit status"
+  unless grep ($_ eq 'futex-mutex: exit(0)', @output);
+
+pass;
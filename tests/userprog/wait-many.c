@@ -0,0 +1,39 @@
+/* Forks a number of children that exit right away, then waits
+   for them in the reverse order.  Each child's exit status has to
+   outlive the child, and a second wait for a child that has
+   already been waited for has to fail. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 20
+
+void
+test_main (void)
+{
+  pid_t pids[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pids[i] = fork ("child");
+      if (pids[i] == 0)
+        exit (100 + i);
+      if (pids[i] < 0)
+        fail ("fork %d failed", i);
+    }
+
+  for (i = CHILD_CNT - 1; i >= 0; i--)
+    {
+      int status = wait (pids[i]);
+      if (status != 100 + i)
+        fail ("child %d exited with %d, expected %d", i, status, 100 + i);
+    }
+  msg ("waited for %d children", CHILD_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (pids[i]) != -1)
+      fail ("second wait for child %d succeeded", i);
+  msg ("second waits failed");
+}
@@ -0,0 +1,232 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Lazy FPU context switching.
+
+   The kernel is compiled with -mno-sse -msoft-float, so it never
+   touches the x87, SSE or AVX registers.  Whatever they hold
+   belongs to one thread, the FPU owner, even while other threads
+   run.  Switching to any other thread sets CR0.TS, so that its
+   first FPU or SIMD instruction raises #NM.  The #NM handler then
+   saves the owner's registers, loads the running thread's, and
+   makes it the owner.  Switching between threads that do not use
+   the FPU thus costs nothing, and a thread that does use it pays
+   for a save and restore only if another thread used the FPU in
+   between.
+
+   A thread's registers are saved in a page allocated at its first
+   FPU instruction.  If the CPU has XSAVE, it saves the x87, SSE
+   and, if present, AVX state; otherwise, FXSAVE saves the x87 and
+   SSE state.  See [IA32-v3a] chapter 13 "Managing State Using the
+   XSAVE Feature Set". */
+
+/* CR0 and CR4 bits. */
+#define CR0_MP 0x00000002           /* Monitor coprocessor. */
+#define CR0_EM 0x00000004           /* x87 emulation. */
+#define CR0_TS 0x00000008           /* Task switched. */
+#define CR4_OSFXSR 0x00000200       /* FXSAVE and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400   /* SIMD exceptions raise #XF. */
+#define CR4_OSXSAVE 0x00040000      /* XSAVE and XCR0 enabled. */
+
+/* CPUID leaf 1 ECX bits. */
+#define CPUID_XSAVE (1 << 26)
+#define CPUID_AVX (1 << 28)
+
+/* XCR0 state components. */
+#define XCR0_X87 0x1
+#define XCR0_SSE 0x2
+#define XCR0_AVX 0x4
+
+/* Initial state, stored in the legacy region that FXSAVE and
+   XSAVE share.  An XSAVE area whose header is all zeros restores
+   every component to its initial state, except that MXCSR is
+   still loaded from the area. */
+#define FCW_OFS 0                   /* Offset of the x87 control word. */
+#define MXCSR_OFS 24                /* Offset of MXCSR. */
+#define FCW_INIT 0x037f             /* All x87 exceptions masked. */
+#define MXCSR_INIT 0x1f80           /* All SIMD exceptions masked. */
+
+static bool use_xsave;              /* XSAVE, or FXSAVE? */
+static size_t area_size;            /* Bytes used in a save area. */
+static struct thread *fpu_owner;    /* Thread whose state is loaded. */
+static bool ts_set;                 /* Is CR0.TS set? */
+
+/* Statistics. */
+static long long trap_cnt;          /* # of #NM traps. */
+static long long save_cnt;          /* # of states saved. */
+
+static intr_handler_func fpu_trap;
+static void save (void *area);
+static void restore (void *area);
+static void set_ts (void);
+
+/* Enables the FPU and SSE, and XSAVE if the CPU has it, with
+   CR0.TS set so that the first FPU instruction traps. */
+void
+fpu_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "a" (1));
+
+	lcr0 ((rcr0 () | CR0_MP | CR0_TS) & ~CR0_EM);
+	ts_set = true;
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	area_size = 512;
+	if (ecx & CPUID_XSAVE) {
+		lcr4 (rcr4 () | CR4_OSXSAVE);
+		xsetbv (0, XCR0_X87 | XCR0_SSE | (ecx & CPUID_AVX ? XCR0_AVX : 0));
+
+		/* EBX of leaf 0xd is the size of an XSAVE area for the
+		   components now enabled in XCR0. */
+		asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+				: "a" (0xd), "c" (0));
+		area_size = ebx;
+		use_xsave = true;
+	}
+	ASSERT (area_size <= PGSIZE);
+
+	intr_register_int (7, 0, INTR_ON, fpu_trap,
+			"#NM Device Not Available Exception");
+}
+
+/* Called by the scheduler, with interrupts off, just before
+   switching to NEXT.  Sets CR0.TS unless NEXT owns the FPU.  CR0
+   is only written when TS actually changes, so switching among
+   threads that do not own the FPU leaves it alone. */
+void
+fpu_switch (struct thread *next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (next != fpu_owner)
+		set_ts ();
+	else if (ts_set) {
+		clts ();
+		ts_set = false;
+	}
+}
+
+/* Gives CHILD a copy of PARENT's FPU state.  PARENT must not be
+   running, so that its state cannot change meanwhile.  Returns
+   false if memory for the copy could not be allocated. */
+bool
+fpu_fork (struct thread *child, struct thread *parent) {
+	enum intr_level old_level;
+
+	if (parent->fpu == NULL)
+		return true;
+	child->fpu = palloc_get_page (0);
+	if (child->fpu == NULL)
+		return false;
+
+	old_level = intr_disable ();
+	if (fpu_owner == parent) {
+		/* PARENT's state is only in the registers.  Save it, and
+		   leave PARENT the owner. */
+		clts ();
+		save (parent->fpu);
+		ts_set = false;
+		set_ts ();
+	}
+	memcpy (child->fpu, parent->fpu, area_size);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Discards the running thread's FPU state, so that its next FPU
+   instruction starts over from the initial state.  Called when a
+   thread exits or a process loads a new program. */
+void
+fpu_release (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	void *area = curr->fpu;
+
+	if (area == NULL)
+		return;
+
+	old_level = intr_disable ();
+	curr->fpu = NULL;
+	if (fpu_owner == curr) {
+		fpu_owner = NULL;
+		set_ts ();
+	}
+	intr_set_level (old_level);
+	palloc_free_page (area);
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void) {
+	printf ("FPU: %lld traps, %lld state saves\n", trap_cnt, save_cnt);
+}
+
+/* #NM handler.  Makes the running thread the FPU owner, saving
+   the previous owner's state and loading the running thread's,
+   which is the initial state if it never used the FPU before. */
+static void
+fpu_trap (struct intr_frame *f UNUSED) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	if (curr->fpu == NULL) {
+		uint8_t *area = palloc_get_page (PAL_ZERO);
+		if (area == NULL) {
+			printf ("%s: no memory for FPU state.\n", thread_name ());
+			thread_exit ();
+		}
+		*(uint16_t *) (area + FCW_OFS) = FCW_INIT;
+		*(uint32_t *) (area + MXCSR_OFS) = MXCSR_INIT;
+		curr->fpu = area;
+	}
+
+	old_level = intr_disable ();
+	trap_cnt++;
+	clts ();
+	ts_set = false;
+	if (fpu_owner != curr) {
+		if (fpu_owner != NULL)
+			save (fpu_owner->fpu);
+		restore (curr->fpu);
+		fpu_owner = curr;
+	}
+	intr_set_level (old_level);
+}
+
+/* Saves the FPU registers into AREA.  CR0.TS must be clear. */
+static void
+save (void *area) {
+	if (use_xsave)
+		asm volatile ("xsave64 (%0)" : : "r" (area), "a" (-1), "d" (-1)
+				: "memory");
+	else
+		asm volatile ("fxsave64 (%0)" : : "r" (area) : "memory");
+	save_cnt++;
+}
+
+/* Loads the FPU registers from AREA.  CR0.TS must be clear. */
+static void
+restore (void *area) {
+	if (use_xsave)
+		asm volatile ("xrstor64 (%0)" : : "r" (area), "a" (-1), "d" (-1)
+				: "memory");
+	else
+		asm volatile ("fxrstor64 (%0)" : : "r" (area) : "memory");
+}
+
+/* Sets CR0.TS, if it is not set already. */
+static void
+set_ts (void) {
+	if (!ts_set) {
+		lcr0 (rcr0 () | CR0_TS);
+		ts_set = true;
+	}
+}
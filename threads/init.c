@@ -13,6 +13,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -20,7 +21,11 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -49,6 +54,12 @@ static bool format_filesys;
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
+/* -trace: Record kernel events in the trace buffer? */
+static bool tracing;
+
+/* -profile: Sample kernel and user stacks on timer interrupts? */
+static bool profiling;
+
 bool thread_tests;
 
 static void bss_init (void);
@@ -87,6 +98,10 @@ main (void) {
 	mem_end = palloc_init ();
 	malloc_init ();
 	paging_init (mem_end);
+	if (tracing)
+		trace_init ();
+	if (profiling)
+		profile_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -95,17 +110,20 @@ main (void) {
 
 	/* Initialize interrupt handlers. */
 	intr_init ();
+	fpu_init ();
 	timer_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
 	exception_init ();
 	syscall_init ();
+	process_table_init ();
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+	workqueue_init ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -141,28 +159,53 @@ bss_init (void) {
 	memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Size of a large page, mapped by one page directory entry. */
+#define LARGE_PGSIZE (1UL << PDXSHIFT)
+
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
  * Points base_pml4 to the pml4 it creates. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
+	size_t large_cnt = 0, small_cnt = 0;
 	int perm;
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// Every 2 MB region that lies wholly in memory and holds no
+	// kernel text, which must stay read-only, gets a single large
+	// page; the rest gets 4 kB pages.  1 GB pages would never fit:
+	// LOADER_KERN_BASE is not 1 GB aligned, so no 1 GB boundary in
+	// the direct map falls on a 1 GB boundary in physical memory.
+	ASSERT (LOADER_KERN_BASE % LARGE_PGSIZE == 0);
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
+		if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end
+				&& (va + LARGE_PGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)
+				&& (pte = pml4e_walk_pde (pml4, va, 1)) != NULL) {
+			*pte = pa | PTE_P | PTE_W | PTE_PS;
+			large_cnt++;
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
-		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
+		if ((pte = pml4e_walk (pml4, va, 1)) != NULL) {
 			*pte = pa | perm;
+			small_cnt++;
+		}
+		pa += PGSIZE;
 	}
+	printf ("Kernel direct map: %zu 2 MB pages, %zu 4 kB pages\n",
+			large_cnt, small_cnt);
 
 	// reload cr3
 	pml4_activate(0);
@@ -222,6 +265,12 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-trace"))
+			tracing = true;
+		else if (!strcmp (name, "-profile"))
+			profiling = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -231,6 +280,8 @@ parse_options (char **argv) {
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs are mutually exclusive");
 
 	return argv;
 }
@@ -329,6 +380,9 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -trace             Trace kernel events, dump them at power off.\n"
+			"  -profile           Sample stacks, print a profile at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -341,11 +395,17 @@ usage (void) {
    as long as we're running on Bochs or QEMU. */
 void
 power_off (void) {
+	/* Let deferred work reach the disk, unless we are panicking. */
+	if (intr_get_level () == INTR_ON)
+		work_flush ();
+
 #ifdef FILESYS
 	filesys_done ();
 #endif
 
 	print_stats ();
+	trace_dump ();
+	profile_dump ();
 
 	printf ("Powering off...\n");
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
@@ -357,6 +417,11 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	slab_print_stats ();
+	fpu_print_stats ();
+	workqueue_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
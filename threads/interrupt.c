@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
+#include "threads/init.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -107,6 +108,13 @@ static bool yield_on_return;    /* Should we yield on interrupt return? */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
 
+/* Local APIC helpers. */
+static void lapic_init (void);
+static void lapic_end_of_interrupt (void);
+
+/* Vector for spurious local APIC interrupts, which need no EOI. */
+#define LAPIC_SPURIOUS 0xff
+
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 
@@ -164,8 +172,9 @@ void
 intr_init (void) {
 	int i;
 
-	/* Initialize interrupt controller. */
+	/* Initialize interrupt controllers. */
 	pic_init ();
+	lapic_init ();
 
 	/* Initialize IDT. */
 	for (i = 0; i < INTR_CNT; i++) {
@@ -227,7 +236,7 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT ((vec_no >= 0x20 && vec_no <= 0x2f) || vec_no == INTR_LAPIC_TIMER);
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -249,6 +258,7 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
 	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (vec_no != INTR_LAPIC_TIMER && vec_no != LAPIC_SPURIOUS);
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -308,6 +318,39 @@ pic_init (void) {
 	outb (0xa1, 0x00);
 }
 
+/* Masks external interrupt VEC, which must come through the PICs,
+   if MASK is true, or unmasks it otherwise.  The PIC still records
+   a masked interrupt, but does not deliver it until unmasked. */
+void
+intr_mask_ext (uint8_t vec, bool mask) {
+	int port = vec < 0x28 ? 0x21 : 0xa1;
+	uint8_t bit = 1 << (vec & 7);
+	enum intr_level old_level;
+
+	ASSERT (vec >= 0x20 && vec < 0x30);
+
+	old_level = intr_disable ();
+	if (mask)
+		outb (port, inb (port) | bit);
+	else
+		outb (port, inb (port) & ~bit);
+	intr_set_level (old_level);
+}
+
+/* Returns true if external interrupt VEC, which must come through
+   the PICs, has been raised but not yet delivered, which is the
+   case for a masked interrupt.  Reads the PIC's interrupt request
+   register with OCW3. */
+bool
+intr_ext_pending (uint8_t vec) {
+	int port = vec < 0x28 ? 0x20 : 0xa0;
+
+	ASSERT (vec >= 0x20 && vec < 0x30);
+
+	outb (port, 0x0a);
+	return (inb (port) & (1 << (vec & 7))) != 0;
+}
+
 /* Sends an end-of-interrupt signal to the PIC for the given IRQ.
    If we don't acknowledge the IRQ, it will never be delivered to
    us again, so this is important.  */
@@ -322,6 +365,99 @@ pic_end_of_interrupt (int irq) {
 	if (irq >= 0x28)
 		outb (0xa0, 0x20);
 }
+/* Local APIC.
+
+   Besides passing the PICs' interrupts through to the CPU, each
+   CPU's local APIC has a timer of its own, which unlike the 8254
+   can be programmed to interrupt once, after an arbitrary number
+   of bus clock periods.  We leave the PICs in charge of device
+   interrupts and use the local APIC only for that timer.  See
+   [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)". */
+
+/* Local APIC registers, as byte offsets from its base. */
+#define LAPIC_EOI 0x0b0             /* End of interrupt. */
+#define LAPIC_SVR 0x0f0             /* Spurious interrupt vector. */
+#define LAPIC_LVT_TIMER 0x320       /* Timer local vector table entry. */
+#define LAPIC_TIMER_INIT 0x380      /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390       /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0       /* Timer divide configuration. */
+
+#define LAPIC_SVR_ENABLE 0x100      /* SVR: APIC software enable. */
+#define LAPIC_TIMER_DIV_16 0x3      /* DIV: count every 16 bus clocks. */
+#define IA32_APIC_BASE 0x1b         /* MSR holding the APIC's address. */
+
+/* Kernel virtual address of the local APIC registers, or a null
+   pointer if there is no local APIC. */
+static volatile uint8_t *lapic;
+
+/* Returns local APIC register REG. */
+static inline uint32_t
+lapic_read (int reg) {
+	return *(volatile uint32_t *) (lapic + reg);
+}
+
+/* Sets local APIC register REG to VALUE. */
+static inline void
+lapic_write (int reg, uint32_t value) {
+	*(volatile uint32_t *) (lapic + reg) = value;
+}
+
+/* Finds and enables the local APIC, if the CPU has one, and sets
+   up its timer in one-shot mode, stopped.  The registers are
+   memory-mapped above the end of RAM, so they need a mapping of
+   their own, with caching off. */
+static void
+lapic_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t pa, *pte;
+
+	asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			: "a" (1));
+	if (!(edx & (1 << 9)))
+		return;
+
+	pa = read_msr (IA32_APIC_BASE) & ~(uint64_t) (PGSIZE - 1);
+	pte = pml4e_walk (base_pml4, (uint64_t) ptov (pa), 1);
+	if (pte == NULL)
+		return;
+	*pte = pa | PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+	lapic = ptov (pa);
+
+	lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS);
+	lapic_write (LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, INTR_LAPIC_TIMER);
+	lapic_write (LAPIC_TIMER_INIT, 0);
+}
+
+/* Returns true if there is a local APIC timer. */
+bool
+lapic_timer_present (void) {
+	return lapic != NULL;
+}
+
+/* Starts the local APIC timer counting down from COUNT, replacing
+   any countdown in progress.  It interrupts once, when the count
+   reaches 0.  A COUNT of 0 stops the timer. */
+void
+lapic_timer_start (uint32_t count) {
+	ASSERT (lapic != NULL);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Returns the local APIC timer's remaining count. */
+uint32_t
+lapic_timer_count (void) {
+	ASSERT (lapic != NULL);
+	return lapic_read (LAPIC_TIMER_CUR);
+}
+
+/* Sends an end-of-interrupt signal to the local APIC. */
+static void
+lapic_end_of_interrupt (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
 /* Interrupt handlers. */
 
 /* Handler for all interrupts, faults, and exceptions.  This
@@ -337,20 +473,26 @@ intr_handler (struct intr_frame *frame) {
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = (frame->vec_no >= 0x20 && frame->vec_no < 0x30)
+		|| frame->vec_no == INTR_LAPIC_TIMER;
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* If the CPU was idle with the timer tick stopped, catch up
+		   on the tick before any handler looks at the time. */
+		timer_idle_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_SPURIOUS) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -367,10 +509,13 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_context ());
 
 		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		if (frame->vec_no == INTR_LAPIC_TIMER)
+			lapic_end_of_interrupt ();
+		else
+			pic_end_of_interrupt (frame->vec_no);
 
 		if (yield_on_return)
-			thread_yield ();
+			thread_preempt ();
 	}
 }
 
@@ -11,10 +11,15 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Size classes are 8 bytes apart up
+   to 128 bytes, then four to each power of 2 up to 1 kB, so that
+   rounding up wastes at most a quarter of the block.  Two more
+   classes above that are sized to fit three and two blocks to a
+   page.  A table indexed by size maps each request to its class
+   in constant time.  The descriptor keeps a list of free blocks.
+   If the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
@@ -29,7 +34,7 @@
    and give the arena back to the page allocator.
 
    We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
+   because they're too big to fit two to a page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
@@ -40,6 +45,11 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics. */
+	long long alloc_cnt;        /* Blocks allocated. */
+	long long requested;        /* Bytes asked for in those blocks. */
+	size_t arena_cnt;           /* Arenas currently allocated. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -58,25 +68,84 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Largest block a descriptor hands out: two to a page. */
+#define MAX_BLOCK_SIZE ROUND_DOWN ((PGSIZE - sizeof (struct arena)) / 2, 8)
+
+/* Maps a request of SIZE bytes, for 0 < SIZE <= MAX_BLOCK_SIZE, to
+   the smallest descriptor that satisfies it, as
+   descs[size_class[DIV_ROUND_UP (SIZE, 8)]]. */
+static uint8_t size_class[MAX_BLOCK_SIZE / 8 + 1];
+
+/* Statistics for big blocks, which have no descriptor. */
+static struct lock big_lock;    /* Protects the counters below. */
+static long long big_cnt;       /* Big blocks allocated. */
+static long long big_requested; /* Bytes asked for in big blocks. */
+static long long big_reserved;  /* Bytes of pages given to them. */
+
+static void add_desc (size_t block_size);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
-
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
-		lock_init (&d->lock);
+	size_t base, i;
+
+	for (base = 16; base <= 128; base += 8)
+		add_desc (base);
+	for (base = 128; base < 1024; base *= 2)
+		for (i = 1; i <= 4; i++)
+			add_desc (base + base / 4 * i);
+	add_desc (ROUND_DOWN ((PGSIZE - sizeof (struct arena)) / 3, 8));
+	add_desc (MAX_BLOCK_SIZE);
+
+	for (i = 1, base = 0; i < sizeof size_class; i++) {
+		while (descs[base].block_size < i * 8)
+			base++;
+		size_class[i] = base;
 	}
+
+	lock_init (&big_lock);
+}
+
+/* Prints malloc() statistics. */
+void
+malloc_print_stats (void) {
+	long long cnt = big_cnt, requested = big_requested;
+	long long reserved = big_reserved;
+	size_t arenas = 0;
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt; d++) {
+		cnt += d->alloc_cnt;
+		requested += d->requested;
+		reserved += d->alloc_cnt * d->block_size;
+		arenas += d->arena_cnt;
+	}
+	printf ("Malloc: %lld allocations, %lld bytes requested, "
+			"%lld bytes reserved, %zu arenas in use\n",
+			cnt, requested, reserved, arenas);
+}
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes, which must be
+   larger than those of any descriptor added before. */
+static void
+add_desc (size_t block_size) {
+	struct desc *d = &descs[desc_cnt++];
+
+	ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+	ASSERT (desc_cnt == 1 || block_size > d[-1].block_size);
+	ASSERT (block_size >= sizeof (struct block));
+
+	d->block_size = block_size;
+	d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+	list_init (&d->free_list);
+	lock_init (&d->lock);
+	d->alloc_cnt = d->requested = 0;
+	d->arena_cnt = 0;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -91,12 +160,7 @@ malloc (size_t size) {
 	if (size == 0)
 		return NULL;
 
-	/* Find the smallest descriptor that satisfies a SIZE-byte
-	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_BLOCK_SIZE) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -104,6 +168,12 @@ malloc (size_t size) {
 		if (a == NULL)
 			return NULL;
 
+		lock_acquire (&big_lock);
+		big_cnt++;
+		big_requested += size;
+		big_reserved += page_cnt * PGSIZE;
+		lock_release (&big_lock);
+
 		/* Initialize the arena to indicate a big block of PAGE_CNT
 		   pages, and return it. */
 		a->magic = ARENA_MAGIC;
@@ -112,6 +182,11 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	d = &descs[size_class[DIV_ROUND_UP (size, 8)]];
+	ASSERT (d->block_size >= size);
+
 	lock_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
@@ -133,12 +208,15 @@ malloc (size_t size) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		d->arena_cnt++;
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
+	d->alloc_cnt++;
+	d->requested += size;
 	lock_release (&d->lock);
 	return b;
 }
@@ -228,6 +306,7 @@ free (void *p) {
 					list_remove (&b->free_elem);
 				}
 				palloc_free_page (a);
+				d->arena_cnt--;
 			}
 
 			lock_release (&d->lock);
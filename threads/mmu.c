@@ -13,6 +13,9 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		/* A 2 MB page has no page table to walk into. */
+		if ((uint64_t) pte & PTE_PS)
+			return NULL;
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -35,6 +38,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 	int allocated = 0;
 	if (pdpe) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
+		/* Nor does a 1 GB page. */
+		if ((uint64_t) pde & PTE_PS)
+			return NULL;
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -88,6 +94,37 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in page map level 4, PML4E, which maps the 2 MB
+ * region that holds VA.  If PML4E has no page directory for VA,
+ * one is created if CREATE is true; otherwise, or if VA lies in a
+ * 1 GB page, a null pointer is returned. */
+uint64_t *
+pml4e_walk_pde (uint64_t *pml4e, const uint64_t va, int create) {
+	uint64_t *pdpe, *pgdir;
+
+	if (pml4e == NULL)
+		return NULL;
+	if (!(pml4e[PML4 (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pml4e[PML4 (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pdpe = ptov (PTE_ADDR (pml4e[PML4 (va)]));
+
+	if (pdpe[PDPE (va)] & PTE_PS)
+		return NULL;
+	if (!(pdpe[PDPE (va)] & PTE_P)) {
+		uint64_t *new_page = create ? palloc_get_page (PAL_ZERO) : NULL;
+		if (new_page == NULL)
+			return NULL;
+		pdpe[PDPE (va)] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	pgdir = ptov (PTE_ADDR (pdpe[PDPE (va)]));
+	return &pgdir[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,7 +159,8 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* Large pages have no PTE to pass to FUNC. */
+		if (((uint64_t) pte) & PTE_P && !(pdp[i] & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -135,7 +173,7 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
+		if (((uint64_t) pde) & PTE_P && !(pdp[i] & PTE_PS))
 			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
 					 aux, pml4_index, i))
 				return false;
@@ -143,7 +181,9 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * The parts of the kernel's direct map that use large pages have
+ * no PTEs, so they are skipped. */
 bool
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
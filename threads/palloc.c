@@ -2,14 +2,16 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +26,71 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  Free memory is kept as blocks of 2**K pages, each
+   aligned to its own size relative to the pool base, on one free
+   list per order K.  An allocation takes the smallest block that
+   is big enough, splitting larger blocks in half as needed, and
+   gives back any pages beyond the ones requested.  A freed block
+   is merged with its "buddy", the other half of the block it was
+   split from, for as long as the buddy is free too.  Both take
+   O(lg n) time.  The bookkeeping lives in an array beside the
+   pool rather than in the free pages themselves, so free pages
+   are never written to.
+
+   The buddy state is protected by turning interrupts off, not by
+   a lock, because pages are freed from inside the scheduler: a
+   dying thread's page is freed by do_schedule(), with interrupts
+   already off and the current thread possibly already on the
+   ready queue, where it must not block.  The critical sections are
+   short, and none of them touches page contents.
+
+   Each pool also keeps a small stock of pages that have already
+   been zeroed, so that a PAL_ZERO request for a single page, such
+   as every page fault's, need not clear the page itself.  The idle
+   thread refills the stock, up to ZERO_MAX pages, one page at a
+   time for as long as no other thread is ready, so pages are only
+   ever cleared in CPU time that nobody else wants, whichever
+   scheduler is in use.  Stocked pages count as allocated, so they
+   are handed back to the buddy allocator when a pool would
+   otherwise run out. */
+
+/* Largest block order.  Blocks hold at most 2**MAX_ORDER pages. */
+#define MAX_ORDER 20
+
+/* Most pages in each pool's stock of zeroed pages. */
+#define ZERO_MAX 64
+
+/* Per-page buddy allocator state. */
+struct page_info {
+	struct list_elem elem;          /* Element in a free list. */
+	int8_t order;                   /* Order if a free block starts here,
+	                                   otherwise -1. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	struct page_info *pages;        /* One per page in the pool. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+	size_t free_cnt[MAX_ORDER + 1]; /* Number of blocks in each list. */
+	uint32_t free_mask;             /* Bit K set if free_lists[K] is not
+	                                   empty. */
+	struct list zeroed;             /* Zeroed pages, linked through their
+	                                   page_info. */
+	size_t zeroed_cnt;              /* Number of pages in zeroed. */
+
+	/* Statistics. */
+	size_t free_pages;              /* Pages free. */
+	long long split_cnt;            /* Blocks split in two. */
+	long long merge_cnt;            /* Blocks merged with their buddy. */
+	long long fail_cnt;             /* Allocations that failed. */
+	long long zero_hit_cnt;         /* PAL_ZERO pages taken from zeroed. */
+	long long zero_miss_cnt;        /* PAL_ZERO pages cleared on demand. */
+	long long zero_fill_cnt;        /* Pages cleared for zeroed. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +102,14 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void init_free_lists (struct pool *);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void print_pool_stats (const char *name, const struct pool *);
+static size_t take_zeroed (struct pool *);
+static bool drain_zeroed (struct pool *);
+static bool fill_zeroed (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -232,6 +300,10 @@ split:
 			}
 		}
 	}
+
+	// Hand the usable pages to the buddy allocator.
+	init_free_lists (&kernel_pool);
+	init_free_lists (&user_pool);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -262,10 +334,28 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	enum intr_level old_level;
+	bool zeroed = false;
+
+	old_level = intr_disable ();
+	size_t page_idx = BITMAP_ERROR;
+	if (page_cnt == 1 && (flags & PAL_ZERO))
+		page_idx = take_zeroed (pool);
+	if (page_idx != BITMAP_ERROR) {
+		zeroed = true;
+		pool->zero_hit_cnt++;
+	} else {
+		page_idx = alloc_pages (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR && page_cnt == 1)
+			page_idx = take_zeroed (pool);
+		else if (page_idx == BITMAP_ERROR && drain_zeroed (pool))
+			page_idx = alloc_pages (pool, page_cnt);
+		if (page_idx == BITMAP_ERROR)
+			pool->fail_cnt++;
+		else if (flags & PAL_ZERO)
+			pool->zero_miss_cnt += page_cnt;
+	}
+	intr_set_level (old_level);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -274,13 +364,14 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 		pages = NULL;
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
 	}
 
+	TRACE (TRACE_PALLOC, page_cnt, pages);
 	return pages;
 }
 
@@ -300,6 +391,7 @@ palloc_get_page (enum palloc_flags flags) {
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
+	enum intr_level old_level;
 	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
@@ -318,8 +410,11 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	free_pages (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +423,270 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one page for a pool's stock of zeroed pages, if a stock
+   is short and its pool has pages to spare.  Returns true if it
+   zeroed a page, false if there was nothing to do.  Called by the
+   idle thread, with interrupts on, between checks for other
+   threads becoming ready. */
+bool
+palloc_zero_idle (void) {
+	return fill_zeroed (&kernel_pool) || fill_zeroed (&user_pool);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("Kernel", &kernel_pool);
+	print_pool_stats ("User", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's used_map at its base, followed by the
+     buddy allocator's per-page array.  Calculate the space needed
+     for both and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t info_pages = DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+	int order;
 
-	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->pages = (struct page_info *) ((uint8_t *) *bm_base + bm_pages);
+	for (order = 0; order <= MAX_ORDER; order++) {
+		list_init (&p->free_lists[order]);
+		p->free_cnt[order] = 0;
+	}
+	p->free_mask = 0;
+	list_init (&p->zeroed);
+	p->zeroed_cnt = 0;
+	p->free_pages = 0;
+	p->split_cnt = p->merge_cnt = p->fail_cnt = 0;
+	p->zero_hit_cnt = p->zero_miss_cnt = p->zero_fill_cnt = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
-	*bm_base += bm_pages;
+	*bm_base += bm_pages + info_pages;
+}
+
+/* Puts every page of P that is marked free in its used_map on
+   P's free lists. */
+static void
+init_free_lists (struct pool *p) {
+	size_t page_cnt = bitmap_size (p->used_map);
+	size_t start, end;
+
+	for (start = 0; start < page_cnt; start++)
+		p->pages[start].order = -1;
+
+	start = bitmap_scan (p->used_map, 0, 1, false);
+	while (start != BITMAP_ERROR) {
+		end = bitmap_scan (p->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = page_cnt;
+		free_pages (p, start, end - start);
+		start = end < page_cnt ? bitmap_scan (p->used_map, end, 1, false)
+			: BITMAP_ERROR;
+	}
+}
+
+/* Returns the order of the smallest block that holds PAGE_CNT
+   pages, which must be nonzero. */
+static int
+block_order (size_t page_cnt) {
+	return page_cnt > 1 ? 64 - __builtin_clzll (page_cnt - 1) : 0;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX in P to its free
+   list. */
+static void
+push_block (struct pool *p, size_t page_idx, int order) {
+	p->pages[page_idx].order = order;
+	list_push_back (&p->free_lists[order], &p->pages[page_idx].elem);
+	p->free_cnt[order]++;
+	p->free_mask |= 1u << order;
+}
+
+/* Removes the block of 2**ORDER pages at PAGE_IDX in P from its
+   free list. */
+static void
+remove_block (struct pool *p, size_t page_idx, int order) {
+	ASSERT (p->pages[page_idx].order == order);
+
+	p->pages[page_idx].order = -1;
+	list_remove (&p->pages[page_idx].elem);
+	if (--p->free_cnt[order] == 0)
+		p->free_mask &= ~(1u << order);
+}
+
+/* Allocates PAGE_CNT contiguous pages from P and marks them used.
+   Returns the index of the first page, or BITMAP_ERROR if P has
+   no free block large enough.  Interrupts must be off. */
+static size_t
+alloc_pages (struct pool *p, size_t page_cnt) {
+	int want, order;
+	uint32_t mask;
+	size_t page_idx, block_cnt;
+
+	if (page_cnt == 0 || page_cnt > ((size_t) 1 << MAX_ORDER))
+		return BITMAP_ERROR;
+	want = block_order (page_cnt);
+
+	/* Take the smallest free block of at least the wanted order. */
+	mask = p->free_mask & ~((1u << want) - 1);
+	if (mask == 0)
+		return BITMAP_ERROR;
+	order = __builtin_ctz (mask);
+	page_idx = list_entry (list_front (&p->free_lists[order]),
+			struct page_info, elem) - p->pages;
+	remove_block (p, page_idx, order);
+
+	/* Split it down to the wanted order, freeing upper halves. */
+	while (order > want) {
+		order--;
+		push_block (p, page_idx + ((size_t) 1 << order), order);
+		p->split_cnt++;
+	}
+
+	/* Give back the pages past PAGE_CNT. */
+	block_cnt = (size_t) 1 << want;
+	p->free_pages -= block_cnt;
+	if (block_cnt > page_cnt)
+		free_pages (p, page_idx + page_cnt, block_cnt - page_cnt);
+
+	ASSERT (!bitmap_contains (p->used_map, page_idx, page_cnt, true));
+	bitmap_set_multiple (p->used_map, page_idx, page_cnt, true);
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX in P, which
+   are already marked free in P's used_map, to the free lists, as
+   the largest aligned blocks that fit.  Interrupts must be off,
+   unless the system is still starting up. */
+static void
+free_pages (struct pool *p, size_t page_idx, size_t page_cnt) {
+	p->free_pages += page_cnt;
+	while (page_cnt > 0) {
+		int order = 63 - __builtin_clzll (page_cnt);
+
+		if (page_idx != 0 && __builtin_ctzll (page_idx) < order)
+			order = __builtin_ctzll (page_idx);
+		if (order > MAX_ORDER)
+			order = MAX_ORDER;
+		free_block (p, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX in P on a
+   free list, first merging it with its buddy for as long as the
+   buddy is a free block of the same order. */
+static void
+free_block (struct pool *p, size_t page_idx, int order) {
+	size_t page_cnt = bitmap_size (p->used_map);
+
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy >= page_cnt || p->pages[buddy].order != order)
+			break;
+		remove_block (p, buddy, order);
+		p->merge_cnt++;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	push_block (p, page_idx, order);
+}
+
+/* Prints statistics for pool P, called NAME. */
+static void
+print_pool_stats (const char *name, const struct pool *p) {
+	size_t largest = 0;
+	int order;
+
+	if (p->free_mask != 0)
+		largest = (size_t) 1 << (31 - __builtin_clz (p->free_mask));
+	printf ("%s pool: %zu of %zu pages free, largest free block %zu pages, "
+			"%zu%% fragmented\n", name, p->free_pages,
+			bitmap_size (p->used_map), largest,
+			p->free_pages > 0 ? 100 - largest * 100 / p->free_pages : 0);
+	printf ("%s pool: %lld splits, %lld merges, %lld failed allocations, "
+			"free blocks by order:", name, p->split_cnt, p->merge_cnt,
+			p->fail_cnt);
+	for (order = 0; order <= MAX_ORDER; order++)
+		if (p->free_mask >> order != 0)
+			printf (" %zu", p->free_cnt[order]);
+	printf ("\n");
+	printf ("%s pool: %zu zeroed pages in stock, %lld hits, %lld misses "
+			"(%lld%% hit rate), %lld pages zeroed while idle\n",
+			name, p->zeroed_cnt, p->zero_hit_cnt, p->zero_miss_cnt,
+			p->zero_hit_cnt + p->zero_miss_cnt > 0
+			? p->zero_hit_cnt * 100 / (p->zero_hit_cnt + p->zero_miss_cnt) : 0,
+			p->zero_fill_cnt);
+}
+
+/* Takes a page from P's stock of zeroed pages, and returns its
+   index, or BITMAP_ERROR if the stock is empty.  Interrupts must
+   be off. */
+static size_t
+take_zeroed (struct pool *p) {
+	size_t page_idx;
+
+	if (list_empty (&p->zeroed))
+		return BITMAP_ERROR;
+
+	page_idx = list_entry (list_pop_front (&p->zeroed),
+			struct page_info, elem) - p->pages;
+	p->zeroed_cnt--;
+	return page_idx;
+}
+
+/* Returns every page in P's stock of zeroed pages to the free
+   lists.  Returns true if there were any.  Interrupts must be
+   off. */
+static bool
+drain_zeroed (struct pool *p) {
+	if (list_empty (&p->zeroed))
+		return false;
+
+	while (!list_empty (&p->zeroed)) {
+		size_t page_idx = list_entry (list_pop_front (&p->zeroed),
+				struct page_info, elem) - p->pages;
+
+		bitmap_reset (p->used_map, page_idx);
+		free_pages (p, page_idx, 1);
+	}
+	p->zeroed_cnt = 0;
+	return true;
+}
+
+/* Zeroes one page for P's stock, unless the stock already holds
+   ZERO_MAX pages or P has no more than that left free.  Returns
+   true if it zeroed a page. */
+static bool
+fill_zeroed (struct pool *p) {
+	size_t page_idx = BITMAP_ERROR;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (p->zeroed_cnt < ZERO_MAX && p->free_pages > ZERO_MAX)
+		page_idx = alloc_pages (p, 1);
+	intr_set_level (old_level);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	memset (p->base + PGSIZE * page_idx, 0, PGSIZE);
+
+	old_level = intr_disable ();
+	list_push_back (&p->zeroed, &p->pages[page_idx].elem);
+	p->zeroed_cnt++;
+	p->zero_fill_cnt++;
+	intr_set_level (old_level);
+	return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,208 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "threads/mmu.h"
+#endif
+
+/* Deepest stack recorded, counting kernel and user frames. */
+#define PROFILE_DEPTH 16
+
+/* Number of distinct stacks the table can hold. */
+#define PROFILE_STACKS 512
+
+/* Bit set in a recorded address taken from a user stack. */
+#define USER_FRAME ((uintptr_t) 1 << 63)
+
+/* A distinct stack and the number of samples that hit it. */
+struct profile_stack {
+	uint64_t hash;              /* Hash of depth and pcs. */
+	unsigned count;             /* Samples, or 0 if slot is free. */
+	int depth;                  /* Number of valid pcs. */
+	uintptr_t pcs[PROFILE_DEPTH];   /* Innermost frame first. */
+};
+
+#define PROFILE_PAGES \
+	DIV_ROUND_UP (PROFILE_STACKS * sizeof (struct profile_stack), PGSIZE)
+
+/* True once the table exists and timer interrupts take samples. */
+bool profile_enabled;
+
+static struct profile_stack *stacks;    /* Open-addressed table. */
+static unsigned stack_cnt;              /* Slots in use. */
+static long long sample_cnt;            /* Samples taken. */
+static long long dropped_cnt;           /* Samples lost, table full. */
+
+static int walk_kernel (uintptr_t pcs[], int depth, uintptr_t rbp);
+#ifdef USERPROG
+static int walk_user (uintptr_t pcs[], int depth,
+		const struct intr_frame *);
+static bool read_user (uintptr_t uaddr, uintptr_t *value);
+#endif
+static void record (const uintptr_t pcs[], int depth);
+
+/* Allocates the stack table and turns profiling on. */
+void
+profile_init (void) {
+	stacks = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, PROFILE_PAGES);
+	profile_enabled = true;
+}
+
+/* Takes a sample of the context interrupted with frame F.  Called
+   from the timer interrupt. */
+void
+profile_sample (const struct intr_frame *f) {
+	uintptr_t pcs[PROFILE_DEPTH];
+	int depth = 0;
+
+	ASSERT (intr_context ());
+
+	sample_cnt++;
+	if ((f->cs & 3) == 0) {
+		pcs[depth++] = f->rip;
+		depth = walk_kernel (pcs, depth, f->R.rbp);
+#ifdef USERPROG
+		/* A process in the kernel got there from user mode, which
+		   left the user context at the top of its kernel stack. */
+		if (thread_current ()->pml4 != NULL)
+			depth = walk_user (pcs, depth, (struct intr_frame *)
+					((uint8_t *) thread_current () + PGSIZE) - 1);
+#endif
+	}
+#ifdef USERPROG
+	else
+		depth = walk_user (pcs, depth, f);
+#endif
+	record (pcs, depth);
+}
+
+/* Prints the stack table in folded form, then frees it. */
+void
+profile_dump (void) {
+	unsigned i;
+
+	if (!profile_enabled)
+		return;
+	profile_enabled = false;
+
+	printf ("profile: begin %lld samples, %lld dropped, %u stacks\n",
+			sample_cnt, dropped_cnt, stack_cnt);
+	for (i = 0; i < PROFILE_STACKS; i++) {
+		const struct profile_stack *s = &stacks[i];
+		int j;
+
+		if (s->count == 0)
+			continue;
+		printf ("profile: ");
+		for (j = s->depth - 1; j >= 0; j--)
+			printf ("%s%llx%s", s->pcs[j] & USER_FRAME ? "u" : "",
+					(unsigned long long) (s->pcs[j] & ~USER_FRAME),
+					j > 0 ? ";" : "");
+		printf (" %u\n", s->count);
+	}
+	printf ("profile: end\n");
+}
+
+/* Appends to PCS, which already holds DEPTH frames, the return
+   addresses found by following the chain of saved frame pointers
+   that starts at RBP on the current kernel stack.  Stops at a
+   null or implausible frame pointer, one outside the running
+   thread's page or not above the previous one.  Returns the new
+   depth. */
+static int
+walk_kernel (uintptr_t pcs[], int depth, uintptr_t rbp) {
+	uintptr_t page = (uintptr_t) thread_current ();
+	uintptr_t prev = 0;
+
+	while (depth < PROFILE_DEPTH && rbp > prev && rbp % 8 == 0
+			&& rbp >= page && rbp + 16 <= page + PGSIZE) {
+		uintptr_t *frame = (uintptr_t *) rbp;
+
+		pcs[depth++] = frame[1];
+		prev = rbp;
+		rbp = frame[0];
+	}
+	return depth;
+}
+
+#ifdef USERPROG
+/* Appends to PCS, which already holds DEPTH frames, the user
+   instruction pointer in F and the return addresses found by
+   following F's chain of saved frame pointers through the user
+   stack.  Stops at a frame pointer that is null, not above the
+   previous one, or not mapped.  Returns the new depth. */
+static int
+walk_user (uintptr_t pcs[], int depth, const struct intr_frame *f) {
+	uintptr_t rbp = f->R.rbp;
+	uintptr_t prev = 0;
+
+	if ((f->cs & 3) != 3 || !is_user_vaddr (f->rip))
+		return depth;
+
+	if (depth < PROFILE_DEPTH)
+		pcs[depth++] = f->rip | USER_FRAME;
+	while (depth < PROFILE_DEPTH && rbp > prev && rbp % 8 == 0) {
+		uintptr_t next, ret;
+
+		if (!read_user (rbp, &next) || !read_user (rbp + 8, &ret))
+			break;
+		pcs[depth++] = ret | USER_FRAME;
+		prev = rbp;
+		rbp = next;
+	}
+	return depth;
+}
+
+/* Reads the word at user address UADDR, which must be aligned,
+   into *VALUE, through the running process's page table so that
+   an unmapped address cannot fault.  Returns true if successful,
+   false if UADDR is not mapped. */
+static bool
+read_user (uintptr_t uaddr, uintptr_t *value) {
+	uintptr_t *kaddr;
+
+	if (!is_user_vaddr (uaddr))
+		return false;
+	kaddr = pml4_get_page (thread_current ()->pml4, (void *) uaddr);
+	if (kaddr == NULL)
+		return false;
+	*value = *kaddr;
+	return true;
+}
+#endif
+
+/* Counts a sample of the DEPTH frames in PCS, adding the stack to
+   the table if it is new.  The table uses linear probing. */
+static void
+record (const uintptr_t pcs[], int depth) {
+	uint64_t hash = hash_bytes (pcs, depth * sizeof *pcs) ^ depth;
+	unsigned i, probe;
+
+	for (probe = 0, i = hash % PROFILE_STACKS; probe < PROFILE_STACKS;
+			probe++, i = (i + 1) % PROFILE_STACKS) {
+		struct profile_stack *s = &stacks[i];
+
+		if (s->count == 0) {
+			s->hash = hash;
+			s->depth = depth;
+			memcpy (s->pcs, pcs, depth * sizeof *pcs);
+			s->count = 1;
+			stack_cnt++;
+			return;
+		}
+		if (s->hash == hash && s->depth == depth
+				&& !memcmp (s->pcs, pcs, depth * sizeof *pcs)) {
+			s->count++;
+			return;
+		}
+	}
+	dropped_cnt++;
+}
@@ -0,0 +1,230 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.  See slab.h for the interface.
+
+   Each slab is one page from the kernel pool.  It starts with a
+   struct slab header, followed by an array that links the slab's
+   free objects into a list by index, followed by the objects
+   themselves.  Keeping the links outside the objects is what lets
+   a free object stay constructed.  Because a slab is exactly one
+   page, the slab that holds an object is found by rounding the
+   object's address down to a page boundary, as malloc() does for
+   its arenas.
+
+   A cache keeps slabs that have a free object on its partial
+   list and the rest on its full list.  Allocation takes an object
+   from the first partial slab.  A slab whose objects have all
+   been freed is moved to the back of the partial list, so that
+   slabs still in use are filled first, and the cache keeps at
+   most one such empty slab, returning any others to the page
+   allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* End of a slab's free list. */
+#define SLAB_END UINT16_MAX
+
+/* Slab header, at the start of each slab's page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in cache's partial or full. */
+	size_t in_use;              /* Objects allocated from this slab. */
+	uint16_t free;              /* First free object, or SLAB_END. */
+	uint16_t next[];            /* Free object after each free object. */
+};
+
+/* Every cache, for slab_print_stats(). */
+#define CACHE_MAX 16
+static struct slab_cache *caches[CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *new_slab (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *obj);
+static void *slab_obj (struct slab_cache *, struct slab *, size_t idx);
+
+/* Initializes CACHE to hand out objects of SIZE bytes aligned on
+   ALIGN bytes, a power of 2, or on pointer size if ALIGN is 0.
+   CTOR, if nonnull, constructs each object. */
+void
+slab_init (struct slab_cache *cache, const char *name, size_t size,
+		size_t align, slab_ctor *ctor) {
+	size_t n;
+
+	if (align == 0)
+		align = sizeof (void *);
+	ASSERT (cache != NULL);
+	ASSERT (size > 0);
+	ASSERT ((align & (align - 1)) == 0);
+	ASSERT (cache_cnt < CACHE_MAX);
+
+	cache->name = name;
+	cache->size = size;
+	cache->stride = ROUND_UP (size, align);
+
+	/* Fit as many objects as we can after the header and links. */
+	n = (PGSIZE - sizeof (struct slab)) / (cache->stride + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				align) + n * cache->stride > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < SLAB_END);
+	cache->obj_cnt = n;
+	cache->first = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			align);
+
+	cache->ctor = ctor;
+	lock_init (&cache->lock);
+	list_init (&cache->partial);
+	list_init (&cache->full);
+	cache->slab_cnt = cache->empty_cnt = 0;
+	cache->in_use = cache->max_in_use = 0;
+	cache->alloc_cnt = cache->free_cnt = 0;
+
+	caches[cache_cnt++] = cache;
+}
+
+/* Obtains an object from CACHE and returns it.  Returns a null
+   pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *cache) {
+	struct slab *s;
+	size_t idx;
+
+	lock_acquire (&cache->lock);
+	if (list_empty (&cache->partial) && new_slab (cache) == NULL) {
+		lock_release (&cache->lock);
+		return NULL;
+	}
+
+	s = list_entry (list_front (&cache->partial), struct slab, elem);
+	idx = s->free;
+	s->free = s->next[idx];
+	if (s->in_use++ == 0)
+		cache->empty_cnt--;
+	if (s->free == SLAB_END) {
+		list_remove (&s->elem);
+		list_push_back (&cache->full, &s->elem);
+	}
+
+	cache->alloc_cnt++;
+	if (++cache->in_use > cache->max_in_use)
+		cache->max_in_use = cache->in_use;
+	lock_release (&cache->lock);
+
+	return slab_obj (cache, s, idx);
+}
+
+/* Returns OBJ, which must have been obtained from CACHE with
+   slab_alloc() and be in its constructed state, to CACHE.  Does
+   nothing if OBJ is null. */
+void
+slab_free (struct slab_cache *cache, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (cache, obj);
+	idx = ((uint8_t *) obj - (uint8_t *) s - cache->first) / cache->stride;
+
+	lock_acquire (&cache->lock);
+	ASSERT (s->in_use > 0);
+	if (s->free == SLAB_END) {
+		list_remove (&s->elem);
+		list_push_front (&cache->partial, &s->elem);
+	}
+	s->next[idx] = s->free;
+	s->free = idx;
+
+	if (--s->in_use == 0) {
+		list_remove (&s->elem);
+		if (cache->empty_cnt > 0) {
+			cache->slab_cnt--;
+			s->magic = 0;
+			palloc_free_page (s);
+		} else {
+			cache->empty_cnt++;
+			list_push_back (&cache->partial, &s->elem);
+		}
+	}
+
+	cache->free_cnt++;
+	cache->in_use--;
+	lock_release (&cache->lock);
+}
+
+/* Prints statistics for every slab cache. */
+void
+slab_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct slab_cache *c = caches[i];
+
+		printf ("Slab cache %s: %zu-byte objects, %zu per slab, "
+				"%zu in use (max %zu), %zu slabs, "
+				"%lld allocs, %lld frees\n",
+				c->name, c->size, c->obj_cnt, c->in_use, c->max_in_use,
+				c->slab_cnt, c->alloc_cnt, c->free_cnt);
+	}
+}
+
+/* Adds a new, empty slab to CACHE's partial list and returns it,
+   or returns a null pointer if no page is available.  CACHE's
+   lock must be held. */
+static struct slab *
+new_slab (struct slab_cache *cache) {
+	struct slab *s;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = cache;
+	s->in_use = 0;
+	s->free = 0;
+	for (i = 0; i < cache->obj_cnt; i++) {
+		s->next[i] = i + 1 < cache->obj_cnt ? i + 1 : SLAB_END;
+		if (cache->ctor != NULL)
+			cache->ctor (slab_obj (cache, s, i));
+	}
+
+	list_push_back (&cache->partial, &s->elem);
+	cache->slab_cnt++;
+	cache->empty_cnt++;
+	return s;
+}
+
+/* Returns the slab that holds OBJ, which belongs to CACHE. */
+static struct slab *
+obj_to_slab (struct slab_cache *cache, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid. */
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == cache);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT (pg_ofs (obj) >= cache->first);
+	ASSERT ((pg_ofs (obj) - cache->first) % cache->stride == 0);
+
+	return s;
+}
+
+/* Returns object IDX within slab S of CACHE. */
+static void *
+slab_obj (struct slab_cache *cache, struct slab *s, size_t idx) {
+	ASSERT (idx < cache->obj_cnt);
+	return (uint8_t *) s + cache->first + idx * cache->stride;
+}
@@ -30,8 +30,21 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
+/* Maximum length of a lock->holder chain that priority donation
+   will follow.  Bounds the work done by lock_acquire() when locks
+   are nested deeply (or, by mistake, circularly). */
+#define DONATION_DEPTH_MAX 8
+
+static bool sema_waiter_less (const struct rb_elem *,
+		const struct rb_elem *, void *aux);
+static bool cond_waiter_less (const struct rb_elem *,
+		const struct rb_elem *, void *aux);
+static void donate_priority (struct lock *, int priority, int depth);
+static void donate_readers (struct rwlock *, int priority, int depth);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -46,7 +59,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	rb_init (&sema->waiters, sema_waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,6 +72,7 @@ sema_init (struct semaphore *sema, unsigned value) {
    sema_down function. */
 void
 sema_down (struct semaphore *sema) {
+	struct thread *curr = thread_current ();
 	enum intr_level old_level;
 
 	ASSERT (sema != NULL);
@@ -66,7 +80,8 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		list_push_back (&sema->waiters, &thread_current ()->elem);
+		curr->wait_sema = sema;
+		rb_insert (&sema->waiters, &curr->wait_elem);
 		thread_block ();
 	}
 	sema->value--;
@@ -99,21 +114,49 @@ sema_try_down (struct semaphore *sema) {
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any, which takes O(lg n) time in the number of
+   waiters.  If the woken thread outranks the running thread, it
+   runs right away, or on return from the interrupt when called
+   from an interrupt handler.  A caller that has turned interrupts
+   off is not preempted, because it may be counting on them to
+   stay off; it should call thread_check_preempt() once it turns
+   them back on.
 
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) {
 	enum intr_level old_level;
+	bool woke = false;
 
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters))
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+	if (!rb_empty (&sema->waiters)) {
+		struct rb_elem *e = rb_min (&sema->waiters);
+		struct thread *t = rb_entry (e, struct thread, wait_elem);
+
+		rb_remove (&sema->waiters, e);
+		t->wait_sema = NULL;
+		thread_unblock (t);
+		woke = true;
+	}
 	sema->value++;
 	intr_set_level (old_level);
+
+	if (woke && (old_level == INTR_ON || intr_context ()))
+		thread_check_preempt ();
+}
+
+/* Returns true if the thread waiting on a semaphore through
+   element A should be woken up before the one owning B, that is,
+   if it has higher priority.  Threads of equal priority are woken
+   in the order they started waiting. */
+static bool
+sema_waiter_less (const struct rb_elem *a, const struct rb_elem *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct thread, wait_elem)->priority
+		> rb_entry (b, struct thread, wait_elem)->priority;
 }
 
 static void sema_test_helper (void *sema_);
@@ -171,12 +214,90 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->max_priority = PRI_MIN;
 	sema_init (&lock->semaphore, 1);
 }
 
+/* Makes the running thread the holder of LOCK, which it has just
+   downed.  The lock's cached donation is reset to the priority of
+   the threads still waiting for it, which now donate to the new
+   holder.  Interrupts must be off. */
+static void
+lock_grant (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	struct rb_tree *waiters = &lock->semaphore.waiters;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = curr;
+	list_push_back (&curr->locks, &lock->elem);
+	lock->max_priority = PRI_MIN;
+	if (thread_mlfqs || rb_empty (waiters))
+		return;
+	lock->max_priority = rb_entry (rb_min (waiters),
+			struct thread, wait_elem)->priority;
+	if (lock->max_priority > curr->priority)
+		thread_update_priority (curr);
+}
+
+/* Donates PRIORITY to the holder of LOCK and, if that holder is
+   itself waiting for a lock, on down the chain of holders, for at
+   most DONATION_DEPTH_MAX links counting from DEPTH.  The walk
+   stops early as soon as a lock or holder already has at least
+   PRIORITY, since everything past it must too.  A holder waiting
+   for the readers of a read-write lock to drain passes the
+   donation on to each of those readers.  Interrupts must be off. */
+static void
+donate_priority (struct lock *lock, int priority, int depth) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (; lock != NULL && depth < DONATION_DEPTH_MAX; depth++) {
+		struct thread *holder = lock->holder;
+
+		if (lock->max_priority >= priority)
+			break;
+		lock->max_priority = priority;
+		if (holder == NULL || holder->priority >= priority)
+			break;
+		thread_update_priority (holder);
+		if (holder->wait_on_rwlock != NULL) {
+			donate_readers (holder->wait_on_rwlock, priority, depth + 1);
+			break;
+		}
+		lock = holder->wait_on_lock;
+	}
+}
+
+/* Donates PRIORITY to every thread recorded as holding RW for
+   reading, and on down the chain from each of them, as
+   donate_priority() does for a lock.  Interrupts must be off. */
+static void
+donate_readers (struct rwlock *rw, int priority, int depth) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (depth >= DONATION_DEPTH_MAX || rw->max_priority >= priority)
+		return;
+	rw->max_priority = priority;
+	for (e = list_begin (&rw->holds); e != list_end (&rw->holds);
+			e = list_next (e)) {
+		struct thread *reader = list_entry (e, struct rwlock_hold, elem)->thread;
+
+		if (reader->priority >= priority)
+			continue;
+		thread_update_priority (reader);
+		if (reader->wait_on_lock != NULL)
+			donate_priority (reader->wait_on_lock, priority, depth + 1);
+		else if (reader->wait_on_rwlock != NULL)
+			donate_readers (reader->wait_on_rwlock, priority, depth + 1);
+	}
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
-   thread.
+   thread.  While waiting, the current thread donates its priority
+   to the lock's holder (except under the 4.4BSD scheduler).
 
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
@@ -184,12 +305,22 @@ lock_init (struct lock *lock) {
    we need to sleep. */
 void
 lock_acquire (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
+	if (lock->holder != NULL && !thread_mlfqs) {
+		curr->wait_on_lock = lock;
+		donate_priority (lock, curr->priority, 0);
+	}
 	sema_down (&lock->semaphore);
-	lock->holder = thread_current ();
+	curr->wait_on_lock = NULL;
+	lock_grant (lock);
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -200,30 +331,47 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_grant (lock);
+	intr_set_level (old_level);
 	return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
-   This is lock_release function.
+   Any priority donated through LOCK is given up, which costs
+   O(locks still held), and the CPU is yielded if a thread that
+   is now ready outranks the current thread.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
+	list_remove (&lock->elem);
 	lock->holder = NULL;
+	lock->max_priority = PRI_MIN;
+	if (!thread_mlfqs)
+		thread_update_priority (curr);
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
+
+	if (!intr_context ())
+		thread_check_preempt ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -236,10 +384,11 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One thread waiting on a condition variable. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct rb_elem elem;                /* Element in condition's waiters. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Waiting thread. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -249,7 +398,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	rb_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -274,7 +423,9 @@ cond_init (struct condition *cond) {
    we need to sleep. */
 void
 cond_wait (struct condition *cond, struct lock *lock) {
+	struct thread *curr = thread_current ();
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -282,29 +433,53 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	list_push_back (&cond->waiters, &waiter.elem);
+	waiter.thread = curr;
+
+	/* Donation may change our priority while we wait, and that
+	   re-sorts COND's waiters, so they are only touched with
+	   interrupts off. */
+	old_level = intr_disable ();
+	rb_insert (&cond->waiters, &waiter.elem);
+	curr->wait_cond = cond;
+	curr->cond_elem = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one of them to wake
+   up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!rb_empty (&cond->waiters)) {
+		waiter = rb_entry (rb_min (&cond->waiters),
+				struct semaphore_elem, elem);
+		rb_remove (&cond->waiters, &waiter->elem);
+		waiter->thread->wait_cond = NULL;
+	}
+	intr_set_level (old_level);
+
+	/* Up the semaphore with interrupts back on, so that the waiter
+	   can preempt us right away. */
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -318,6 +493,165 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!rb_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
+
+/* Returns true if the thread waiting on a condition variable
+   through element A should be signaled before the one owning B,
+   as sema_waiter_less() does for semaphores. */
+static bool
+cond_waiter_less (const struct rb_elem *a, const struct rb_elem *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct semaphore_elem, elem)->thread->priority
+		> rb_entry (b, struct semaphore_elem, elem)->thread->priority;
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is waiting on a
+   semaphore or a condition variable, it is moved to its new place
+   among the waiters, in O(lg n) time, so that sema_up() and
+   cond_signal() can always take the first waiter.  Interrupts must
+   be off. */
+void
+synch_set_priority (struct thread *t, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->wait_sema != NULL)
+		rb_remove (&t->wait_sema->waiters, &t->wait_elem);
+	if (t->wait_cond != NULL)
+		rb_remove (&t->wait_cond->waiters, t->cond_elem);
+	t->priority = priority;
+	if (t->wait_sema != NULL)
+		rb_insert (&t->wait_sema->waiters, &t->wait_elem);
+	if (t->wait_cond != NULL)
+		rb_insert (&t->wait_cond->waiters, t->cond_elem);
+}
+
+/* Initializes RW.  A read-write lock may be held by any number of
+   readers at once, or by a single writer.
+
+   Writers are preferred: a writer takes RW's internal lock before
+   waiting for the readers already inside to leave, so readers
+   that arrive after it queue up behind it instead of keeping it
+   out forever.  While it waits, the writer donates its priority
+   to the readers inside, as lock_acquire() does to a lock's
+   holder.  A thread holding more than READ_HOLD_MAX read-write
+   locks for reading at once still gets them, but does not receive
+   donations through the extra ones.  The slots that record a
+   thread's read holds are allocated the first time it acquires a
+   read lock, so that threads that never do pay nothing for them;
+   if that allocation fails, the thread gets its read locks but no
+   donations through them. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->lock);
+	rw->readers = 0;
+	rw->writer_waiting = false;
+	sema_init (&rw->drained, 0);
+	list_init (&rw->holds);
+	rw->max_priority = PRI_MIN;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	if (curr->read_holds == NULL)
+		curr->read_holds = calloc (READ_HOLD_MAX, sizeof *curr->read_holds);
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	rw->readers++;
+	for (i = 0; curr->read_holds != NULL && i < READ_HOLD_MAX; i++) {
+		struct rwlock_hold *h = &curr->read_holds[i];
+		if (h->thread == NULL) {
+			h->thread = curr;
+			h->rwlock = rw;
+			list_push_back (&rw->holds, &h->elem);
+			break;
+		}
+	}
+	intr_set_level (old_level);
+	lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader to leave lets a waiting writer in.  Any
+   priority donated through RW is given up. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int i;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->readers > 0);
+
+	old_level = intr_disable ();
+	for (i = 0; curr->read_holds != NULL && i < READ_HOLD_MAX; i++) {
+		struct rwlock_hold *h = &curr->read_holds[i];
+		if (h->thread != NULL && h->rwlock == rw) {
+			list_remove (&h->elem);
+			h->thread = NULL;
+			h->rwlock = NULL;
+			break;
+		}
+	}
+	if (--rw->readers == 0 && rw->writer_waiting)
+		sema_up (&rw->drained);
+	if (!thread_mlfqs)
+		thread_update_priority (curr);
+	intr_set_level (old_level);
+
+	thread_check_preempt ();
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it for reading or writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	lock_acquire (&rw->lock);
+	old_level = intr_disable ();
+	while (rw->readers > 0) {
+		rw->writer_waiting = true;
+		curr->wait_on_rwlock = rw;
+		if (!thread_mlfqs)
+			donate_readers (rw, curr->priority, 0);
+		sema_down (&rw->drained);
+	}
+	curr->wait_on_rwlock = NULL;
+	rw->writer_waiting = false;
+	rw->max_priority = PRI_MIN;
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (lock_held_by_current_thread (&rw->lock));
+
+	lock_release (&rw->lock);
+}
@@ -3,7 +3,12 @@ threads_SRC += threads/thread.c		# Thread management core.
 threads_SRC += threads/interrupt.c	# Interrupt core.
 threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
+threads_SRC += threads/workqueue.c	# Deferred work.
+threads_SRC += threads/trace.c		# Event tracing.
+threads_SRC += threads/profile.c	# Sampling profiler.
+threads_SRC += threads/fpu.c		# Lazy FPU switching.
 threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Object caches.
 threads_SRC += threads/start.S		# Startup code.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
@@ -5,11 +5,15 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,9 +28,77 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue: processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running.  There is one
+   FIFO list per priority level, and bit P of ready_mask is set
+   exactly when ready_lists[P] is nonempty, so the highest-priority
+   ready thread is found with a single bit scan. */
+static struct list ready_lists[PRI_MAX + 1];
+static uint64_t ready_mask;
+static int ready_cnt;           /* # of threads in the run queue. */
+
+#if PRI_MAX - PRI_MIN >= 64
+#error ready_mask requires at most 64 priority levels
+#endif
+
+/* List of all threads that have not yet exited.  Walked by the
+   4.4BSD scheduler once per second to decay recent_cpu. */
+static struct list all_list;
+
+/* Threads that have not yet exited, hashed by tid for
+   thread_find().  Tids are handed out in sequence, so taking them
+   modulo the bucket count spreads them evenly.  Only changed and
+   walked with interrupts off. */
+#define TID_BUCKET_CNT 64
+static struct list tid_buckets[TID_BUCKET_CNT];
+
+/* Threads whose recent_cpu has changed since the last priority
+   recalculation.  Between the once-per-second decays only running
+   threads accumulate recent_cpu, so the every-fourth-tick
+   recalculation only needs to look at this list rather than at
+   every thread. */
+static struct list cpu_dirty_list;
+
+/* System load average, for the 4.4BSD scheduler. */
+static fixed_t load_avg;
+
+/* Run queue for the completely fair scheduler, used instead of
+   ready_lists when thread_cfs is true.  Ready threads are kept in
+   a red-black tree in order of virtual runtime, so the thread that
+   has had the least weighted CPU time is always the leftmost one.
+   cfs_load is the sum of the weights of the threads in the tree,
+   and min_vruntime is a lower bound on the virtual runtime of every
+   runnable thread that never decreases. */
+static struct rb_tree cfs_tree;
+static int64_t cfs_load;
+static int64_t min_vruntime;
+
+/* Run queue for earliest-deadline-first threads, which outrank
+   every thread in ready_lists or cfs_tree.  Ready EDF threads are
+   kept in order of deadline.  rt_utilization is the sum of
+   budget / period over all EDF threads, in parts per million. */
+static struct rb_tree rt_tree;
+static int64_t rt_utilization;
+
+/* Admission control keeps the total EDF utilization at or below
+   this many parts per million.  EDF can meet every deadline up to
+   a full CPU, but the rest is left for ordinary threads. */
+#define RT_UTIL_MAX 900000
+
+/* CFS weight of each nice value from NICE_MIN to NICE_MAX.  Each
+   step in nice changes a thread's share of the CPU by about 10%
+   relative to a thread at the neighbouring level. */
+static const int nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */  9548,  7620,  6100,  4904,  3906,
+	/*  -5 */  3121,  2501,  1991,  1586,  1277,
+	/*   0 */  1024,   820,   655,   526,   423,
+	/*   5 */   335,   272,   215,   172,   137,
+	/*  10 */   110,    87,    70,    56,    45,
+	/*  15 */    36,    29,    23,    18,    15,
+	/*  20 */    12,
+};
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -40,22 +112,64 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that creating a thread usually skips palloc's bitmap scan and
+   the 4 kB memset of PAL_ZERO.  Only the struct thread at the base
+   of the page needs clearing, which init_thread() does anyway;
+   the rest of the page is stack. */
+#define THREAD_POOL_MAX 16
+static struct list thread_pool;
+static size_t thread_pool_cnt;
+
+/* Threads blocked in thread_sleep(), in ascending order of
+   wakeup_tick, and the earliest wakeup_tick among them (INT64_MAX
+   if there are none), so that the timer interrupt can tell in
+   O(1) whether anybody needs waking. */
 static struct list sleep_thread_list;
+static int64_t next_wakeup_tick;
 
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long voluntary_switches;    /* # of switches by blocking/yield. */
+static long long involuntary_switches;  /* # of switches by preemption. */
+static long long rt_met;        /* # of EDF deadlines met. */
+static long long rt_missed;     /* # of EDF deadlines missed. */
+static long long thread_pool_hits;      /* # of thread pages reused. */
+static long long thread_pool_misses;    /* # of thread pages from palloc. */
+
+/* Histogram of run queue wait, in timer ticks, from the time a
+   thread becomes ready until it runs.  Bucket 0 counts waits of
+   0 ticks and bucket B > 0 counts waits in [2**(B-1), 2**B), with
+   the last bucket also taking everything longer. */
+#define WAIT_HIST_BUCKETS 16
+static long long wait_hist[WAIT_HIST_BUCKETS];
+
+/* Set by thread_preempt() so that schedule() accounts the switch
+   as involuntary. */
+static bool preempting;
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+static unsigned time_slice;     /* # of timer ticks in this time slice. */
+
+/* Completely fair scheduling. */
+#define CFS_LATENCY 8           /* Target latency, in timer ticks. */
+#define CFS_MIN_GRANULARITY 1   /* Shortest time slice, in timer ticks. */
+#define NICE_0_WEIGHT 1024      /* Weight of a thread with nice 0. */
+#define VRUNTIME_TICK 1024      /* Virtual runtime of a tick at nice 0. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -64,8 +178,31 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void tid_insert (struct thread *);
+static void ready_push (struct thread *);
+static struct thread *ready_pop (void);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void set_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static int cfs_weight (const struct thread *);
+static bool vruntime_less (const struct rb_elem *, const struct rb_elem *,
+		void *aux);
+static void cfs_tick (struct thread *);
+static void cfs_place (struct thread *);
+static unsigned cfs_time_slice (const struct thread *);
+static bool deadline_less (const struct rb_elem *, const struct rb_elem *,
+		void *aux);
+static bool rt_preempts (void);
+static void rt_tick (struct thread *);
+static void rt_replenish (struct thread *, int64_t now);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
+static void account_switch (struct thread *prev, struct thread *next);
+static void print_wait_hist (void);
+static void print_thread_table (void);
 
-void check_ready_list(void);
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
@@ -110,14 +247,34 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&ready_lists[pri]);
+	ready_mask = 0;
+	ready_cnt = 0;
 	list_init (&destruction_req);
+	list_init (&thread_pool);
+	thread_pool_cnt = 0;
+	list_init (&sleep_thread_list);
+	next_wakeup_tick = INT64_MAX;
+	list_init (&all_list);
+	for (int i = 0; i < TID_BUCKET_CNT; i++)
+		list_init (&tid_buckets[i]);
+	list_init (&cpu_dirty_list);
+	load_avg = 0;
+	rb_init (&cfs_tree, vruntime_less, NULL);
+	rb_init (&rt_tree, deadline_less, NULL);
+	rt_utilization = 0;
+	cfs_load = 0;
+	min_vruntime = 0;
+	time_slice = TIME_SLICE;
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	list_push_back (&all_list, &initial_thread->all_elem);
+	tid_insert (initial_thread);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -147,14 +304,25 @@ thread_tick (void) {
 	if (t == idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
-	else if (t->pml4 != NULL)
+	else if (t->pml4 != NULL) {
 		user_ticks++;
+		t->user_ticks++;
+	}
 #endif
-	else
+	else {
 		kernel_ticks++;
+		t->kernel_ticks++;
+	}
+
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+	else if (thread_cfs && t != idle_thread)
+		cfs_tick (t);
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	/* EDF threads run until they finish or exhaust their budget. */
+	if (t->rt_period != 0)
+		rt_tick (t);
+	else if (++thread_ticks >= time_slice)
 		intr_yield_on_return ();
 }
 
@@ -163,6 +331,112 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Scheduler: %lld voluntary, %lld involuntary context switches\n",
+			voluntary_switches, involuntary_switches);
+	printf ("Real-time: %lld deadlines met, %lld missed\n", rt_met, rt_missed);
+	printf ("Thread pages: %lld reused, %lld allocated, %lld%% hit rate\n",
+			thread_pool_hits, thread_pool_misses,
+			thread_pool_hits + thread_pool_misses > 0
+			? thread_pool_hits * 100 / (thread_pool_hits + thread_pool_misses)
+			: 0);
+	print_wait_hist ();
+	print_thread_table ();
+}
+
+/* Prints the run queue wait histogram, skipping empty buckets. */
+static void
+print_wait_hist (void) {
+	long long hist[WAIT_HIST_BUCKETS];
+	enum intr_level old_level;
+	int b;
+
+	old_level = intr_disable ();
+	memcpy (hist, wait_hist, sizeof hist);
+	intr_set_level (old_level);
+
+	printf ("Run queue wait (ticks):");
+	for (b = 0; b < WAIT_HIST_BUCKETS; b++) {
+		if (hist[b] == 0)
+			continue;
+		if (b == 0)
+			printf (" 0:%lld", hist[b]);
+		else if (b == 1)
+			printf (" 1:%lld", hist[b]);
+		else if (b == WAIT_HIST_BUCKETS - 1)
+			printf (" %lld+:%lld", 1LL << (b - 1), hist[b]);
+		else
+			printf (" %lld-%lld:%lld", 1LL << (b - 1), (1LL << b) - 1, hist[b]);
+	}
+	printf ("\n");
+}
+
+/* Prints one line of scheduling statistics per live thread.  The
+   statistics are copied out with interrupts off first, because
+   printf() may block and let threads come and go.  Threads
+   created after the buffer is sized are counted but not shown.
+   Must not be called from an interrupt handler. */
+static void
+print_thread_table (void) {
+	static const char *status_names[] = {
+		"run", "ready", "block", "dying"
+	};
+	struct thread_stat {
+		tid_t tid;
+		char name[16];
+		enum thread_status status;
+		int64_t wait_ticks, user_ticks, kernel_ticks;
+		unsigned voluntary, involuntary, missed;
+	};
+	struct thread_stat *stats;
+	enum intr_level old_level;
+	struct list_elem *e;
+	size_t max_cnt, cnt = 0, total = 0, i;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	max_cnt = list_size (&all_list);
+	intr_set_level (old_level);
+
+	stats = malloc (max_cnt * sizeof *stats);
+	if (stats == NULL) {
+		printf ("(thread table not shown: out of memory)\n");
+		return;
+	}
+
+	old_level = intr_disable ();
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e), total++) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		struct thread_stat *s;
+
+		if (cnt >= max_cnt)
+			continue;
+		s = &stats[cnt++];
+		s->tid = t->tid;
+		strlcpy (s->name, t->name, sizeof s->name);
+		s->status = t->status;
+		s->wait_ticks = t->wait_ticks;
+		s->user_ticks = t->user_ticks;
+		s->kernel_ticks = t->kernel_ticks;
+		s->voluntary = t->voluntary_switches;
+		s->involuntary = t->involuntary_switches;
+		s->missed = t->rt_missed;
+	}
+	intr_set_level (old_level);
+
+	printf ("%5s %-15s %-5s %8s %8s %8s %8s %8s %8s\n", "tid", "name",
+			"state", "wait", "user", "kernel", "vol", "invol", "missed");
+	for (i = 0; i < cnt; i++) {
+		struct thread_stat *s = &stats[i];
+		printf ("%5d %-15s %-5s %8lld %8lld %8lld %8u %8u %8u\n",
+				s->tid, s->name, status_names[s->status],
+				s->wait_ticks, s->user_ticks, s->kernel_ticks,
+				s->voluntary, s->involuntary, s->missed);
+	}
+	if (total > cnt)
+		printf ("(%zu more threads not shown)\n", total - cnt);
+	free (stats);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -184,18 +458,28 @@ tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
 	struct thread *t;
+	enum intr_level old_level;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 	
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
+	/* The timer interrupt walks all_list, so T must be linked in
+	   with interrupts off, as thread_exit() unlinks it.  Setting
+	   its priority needs them off too. */
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	tid_insert (t);
+	if (thread_mlfqs && function != idle)
+		mlfqs_update_priority (t);
+	intr_set_level (old_level);
 
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
@@ -208,8 +492,9 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-	/* Add to run queue. */
+	/* Add to run queue, and run it right away if it outranks us. */
 	thread_unblock (t);
+	thread_check_preempt ();
 
 	return tid;
 }
@@ -235,7 +520,8 @@ thread_block (void) {
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Callers that can afford to be preempted
+   follow up with thread_check_preempt(). */
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
@@ -244,23 +530,90 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_push_back (&ready_list, &t->elem);
+	t->ready_tick = timer_ticks ();
+	if (t->rt_period != 0 && t->ready_tick >= t->rt_deadline)
+		rt_replenish (t, t->ready_tick);
+	if (thread_cfs)
+		cfs_place (t);
+	ready_push (t);
 	t->status = THREAD_READY;
 	intr_set_level (old_level);
 }
-/*
+
+/* Returns true if sleeping thread A wakes up before B. */
+static bool
+earlier_wakeup (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct thread, elem)->wakeup_tick
+		< list_entry (b, struct thread, elem)->wakeup_tick;
+}
+
+/* Blocks the running thread until the timer reaches WAKEUP_TICK.
+   Threads with equal deadlines are woken in the order they went
+   to sleep. */
 void
-check_ready_list (void) {
-    int highest_ready_pri;
+thread_sleep (int64_t wakeup_tick) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
-    highest_ready_pri = list_entry(list_begin(&ready_list), struct thread, elem)-> priority;
+	ASSERT (!intr_context ());
+	ASSERT (curr != idle_thread);
 
-    if (highest_ready_pri > thread_get_priority()) {
-	
-	    thread_yield();
+	old_level = intr_disable ();
+	curr->wakeup_tick = wakeup_tick;
+	list_insert_ordered (&sleep_thread_list, &curr->elem, earlier_wakeup, NULL);
+	if (wakeup_tick < next_wakeup_tick)
+		next_wakeup_tick = wakeup_tick;
+	thread_block ();
+	intr_set_level (old_level);
+}
 
-    }
-}*/
+/* Unblocks every sleeping thread whose wakeup_tick is at or
+   before NOW.  Called from the timer interrupt, so it only
+   touches the threads that actually expire. */
+void
+thread_wakeup (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (now < next_wakeup_tick)
+		return;
+
+	while (!list_empty (&sleep_thread_list)) {
+		struct thread *t = list_entry (list_front (&sleep_thread_list),
+				struct thread, elem);
+		if (t->wakeup_tick > now)
+			break;
+		list_pop_front (&sleep_thread_list);
+		thread_unblock (t);
+	}
+	next_wakeup_tick = list_empty (&sleep_thread_list) ? INT64_MAX
+		: list_entry (list_front (&sleep_thread_list),
+				struct thread, elem)->wakeup_tick;
+
+	/* A woken thread that outranks the running thread, including an
+	   EDF thread starting its next period, must not wait for the end
+	   of the time slice. */
+	thread_check_preempt ();
+}
+
+/* Returns the earliest tick at which a sleeping thread is due to
+   wake up, or INT64_MAX if no thread is sleeping. */
+int64_t
+thread_next_wakeup (void) {
+	return next_wakeup_tick;
+}
+
+/* Accounts for CNT timer ticks that the idle thread slept through
+   with the timer tick stopped.  Apart from the statistics, such a
+   tick has nothing to do: the idle thread has no time slice, and
+   the MLFQS does its once-a-second update on a real tick. */
+void
+thread_skip_ticks (int64_t cnt) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (thread_current () == idle_thread);
+
+	idle_ticks += cnt;
+}
 
 /* Returns the name of the running thread. */
 const char *
@@ -292,6 +645,48 @@ thread_tid (void) {
 	return thread_current ()->tid;
 }
 
+/* Returns the thread whose tid is TID, or a null pointer if no
+   such thread exists or it has already exited.
+
+   Must be called with interrupts off.  The thread cannot finish
+   exiting, and so its struct thread stays valid, until the caller
+   turns interrupts back on or blocks. */
+struct thread *
+thread_find (tid_t tid) {
+	struct list *bucket = &tid_buckets[(unsigned) tid % TID_BUCKET_CNT];
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, tid_elem);
+		if (t->tid == tid)
+			return t;
+	}
+	return NULL;
+}
+
+#ifdef USERPROG
+/* Returns true if some thread other than the running one runs in
+   the address space with page map PML4, and so could change or
+   wake a futex in it.  Must be called with interrupts off. */
+bool
+thread_pml4_shared (uint64_t *pml4) {
+	struct thread *curr = thread_current ();
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		if (t != curr && t->pml4 == pml4)
+			return true;
+	}
+	return false;
+}
+#endif
+
 /* Deschedules the current thread and destroys it.  Never
    returns to the caller. */
 void
@@ -301,10 +696,19 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	fpu_release ();
+	free (thread_current ()->read_holds);
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	struct thread *curr = thread_current ();
+	list_remove (&curr->all_elem);
+	list_remove (&curr->tid_elem);
+	if (curr->cpu_dirty)
+		list_remove (&curr->cpu_dirty_elem);
+	if (curr->rt_period != 0)
+		rt_utilization -= curr->rt_budget * 1000000 / curr->rt_period;
 	//printf("do_schedule!\n");
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
@@ -320,54 +724,306 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		list_push_back (&ready_list, &curr->elem);
+	if (curr->rt_throttled) {
+		/* Out of budget: sit out the rest of the period. */
+		thread_sleep (curr->rt_deadline);
+		intr_set_level (old_level);
+		return;
+	}
+	if (curr != idle_thread) {
+		curr->ready_tick = timer_ticks ();
+		ready_push (curr);
+	}
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
 
-bool 
-larger_priority(const struct list_elem *a, const struct list_elem *b, void *aux){
-    return (list_entry(a, struct thread, elem)->priority) > (list_entry(b, struct thread, elem)->priority);
+/* Yields the CPU on behalf of the scheduler rather than the
+   current thread, e.g. at the end of a time slice.  Behaves like
+   thread_yield(), but the switch is accounted as involuntary. */
+void
+thread_preempt (void) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	preempting = true;
+	thread_yield ();
+	intr_set_level (old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's priority to NEW_PRIORITY.  Yields
+   if some ready thread now has a higher priority.  Ignored under
+   the 4.4BSD scheduler, which computes priorities itself. */
 void
 thread_set_priority (int new_priority) {
-	thread_current ()->priority = new_priority;
+	enum intr_level old_level;
+	bool yield;
+
+	ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+	if (thread_mlfqs)
+		return;
+
+	old_level = intr_disable ();
+	thread_current ()->base_priority = new_priority;
+	thread_update_priority (thread_current ());
+	yield = ready_max_priority () > thread_current ()->priority;
+	intr_set_level (old_level);
+
+	if (yield)
+		thread_yield ();
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's priority, including any priority
+   donated to it. */
 int
 thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Recomputes T's effective priority as the larger of its base
+   priority and the highest priority donated through any lock it
+   holds.  Each held lock caches the highest priority among its
+   waiters, so this costs O(locks held by T). */
+void
+thread_update_priority (struct thread *t) {
+	int priority = t->base_priority;
+	struct list_elem *e;
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&t->locks); e != list_end (&t->locks);
+			e = list_next (e)) {
+		struct lock *l = list_entry (e, struct lock, elem);
+		if (l->max_priority > priority)
+			priority = l->max_priority;
+	}
+	for (i = 0; t->read_holds != NULL && i < READ_HOLD_MAX; i++) {
+		struct rwlock_hold *h = &t->read_holds[i];
+		if (h->thread != NULL && h->rwlock->max_priority > priority)
+			priority = h->rwlock->max_priority;
+	}
+	set_priority (t, priority);
+}
+
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  Within an interrupt handler, the CPU is
+   yielded on return from the interrupt instead. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_check_preempt (void) {
+	enum intr_level old_level;
+	bool yield;
+
+	old_level = intr_disable ();
+	yield = ready_max_priority () > thread_current ()->priority;
+	intr_set_level (old_level);
+
+	if (!yield)
+		return;
+	if (intr_context ())
+		intr_yield_on_return ();
+	else
+		thread_yield ();
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue list if it is ready, and to its new place
+   among the waiters of any semaphore or condition variable it is
+   waiting on. */
+static void
+set_priority (struct thread *t, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (priority == t->priority)
+		return;
+	if (t->status == THREAD_READY) {
+		ready_remove (t);
+		synch_set_priority (t, priority);
+		ready_push (t);
+	} else
+		synch_set_priority (t, priority);
+}
+
+/* Sets the current thread's nice value to NICE.  Under the
+   4.4BSD scheduler, also recalculates its priority, yielding if
+   it is no longer the highest. */
+void
+thread_set_nice (int nice) {
+	enum intr_level old_level;
+	bool yield;
+
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable ();
+	thread_current ()->nice = nice;
+	if (thread_mlfqs)
+		mlfqs_update_priority (thread_current ());
+	yield = ready_max_priority () > thread_current ()->priority;
+	intr_set_level (old_level);
+
+	if (yield)
+		thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
+}
+
+/* Makes the current thread a periodic earliest-deadline-first
+   thread that may run for BUDGET timer ticks in every PERIOD
+   ticks, with each period's work due by the end of the period.
+   EDF threads run ahead of all other threads, in order of
+   deadline.  A thread that uses up its budget is not run again
+   until its next period begins.
+
+   Returns false, leaving the thread unchanged, if admitting it
+   would push the total utilization of the EDF threads past
+   RT_UTIL_MAX, beyond which deadlines could not be guaranteed.
+   A PERIOD of 0 returns the thread to its ordinary class. */
+bool
+thread_set_period (int64_t period, int64_t budget) {
+	struct thread *curr = thread_current ();
+	int64_t old_util, new_util;
+	enum intr_level old_level;
+
+	ASSERT (period == 0 || (0 < budget && budget <= period));
+
+	old_level = intr_disable ();
+	old_util = curr->rt_period != 0
+		? curr->rt_budget * 1000000 / curr->rt_period : 0;
+	new_util = period != 0 ? budget * 1000000 / period : 0;
+	if (rt_utilization - old_util + new_util > RT_UTIL_MAX) {
+		intr_set_level (old_level);
+		return false;
+	}
+	rt_utilization += new_util - old_util;
+
+	curr->rt_period = period;
+	curr->rt_budget = budget;
+	curr->rt_runtime = budget;
+	curr->rt_deadline = timer_ticks () + period;
+	curr->rt_job_done = false;
+	curr->rt_throttled = false;
+	intr_set_level (old_level);
+
+	/* Leaving the EDF class may let another EDF thread in. */
+	if (period == 0)
+		thread_check_preempt ();
+	return true;
+}
+
+/* Tells the scheduler that the current EDF thread has finished its
+   work for this period, and sleeps until the next period begins
+   with a fresh budget. */
+void
+thread_wait_period (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (curr->rt_period != 0);
+
+	old_level = intr_disable ();
+	curr->rt_job_done = true;
+	thread_sleep (curr->rt_deadline);
+	intr_set_level (old_level);
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load_avg_100 = fp_round (load_avg * 100);
+	intr_set_level (old_level);
+	return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent_cpu_100 = fp_round (thread_current ()->recent_cpu * 100);
+	intr_set_level (old_level);
+	return recent_cpu_100;
+}
+
+/* Recalculates T's 4.4BSD priority from its recent_cpu and nice
+   values, moving T to the right run queue list if it is ready:
+   priority = PRI_MAX - (recent_cpu / 4) - (nice * 2). */
+static void
+mlfqs_update_priority (struct thread *t) {
+	int priority = PRI_MAX - fp_trunc (t->recent_cpu / 4) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	else if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	set_priority (t, priority);
+}
+
+/* 4.4BSD scheduler bookkeeping for one timer tick, with T the
+   running thread.
+
+   Once per second, load_avg is updated and every thread's
+   recent_cpu decays, so every priority is recalculated; threads
+   whose recent_cpu is zero are skipped because decay leaves it
+   unchanged.  On every fourth tick in between, only the threads
+   on cpu_dirty_list have had recent_cpu change, so only they are
+   recalculated.  The per-tick cost is therefore independent of
+   the number of threads except on the once-per-second tick. */
+static void
+mlfqs_tick (struct thread *t) {
+	int64_t ticks = timer_ticks ();
+	struct list_elem *e;
+
+	if (t != idle_thread) {
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+		if (!t->cpu_dirty) {
+			t->cpu_dirty = true;
+			list_push_back (&cpu_dirty_list, &t->cpu_dirty_elem);
+		}
+	}
+
+	if (ticks % TIMER_FREQ == 0) {
+		int ready_threads = ready_cnt + (t != idle_thread ? 1 : 0);
+		fixed_t coef;
+
+		load_avg = fp_mul (fp_div (fp_from_int (59), fp_from_int (60)), load_avg)
+			+ fp_from_int (ready_threads) / 60;
+		coef = fp_div (2 * load_avg, fp_add_int (2 * load_avg, 1));
+
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *th = list_entry (e, struct thread, all_elem);
+			if (th == idle_thread)
+				continue;
+			if (th->recent_cpu != 0)
+				th->recent_cpu = fp_add_int (fp_mul (coef, th->recent_cpu), th->nice);
+			else if (th->nice == 0)
+				continue;
+			else
+				th->recent_cpu = fp_from_int (th->nice);
+			mlfqs_update_priority (th);
+		}
+		while (!list_empty (&cpu_dirty_list))
+			list_entry (list_pop_front (&cpu_dirty_list),
+					struct thread, cpu_dirty_elem)->cpu_dirty = false;
+	} else if (ticks % 4 == 0) {
+		while (!list_empty (&cpu_dirty_list)) {
+			struct thread *th = list_entry (list_pop_front (&cpu_dirty_list),
+					struct thread, cpu_dirty_elem);
+			th->cpu_dirty = false;
+			mlfqs_update_priority (th);
+		}
+	} else
+		return;
+
+	if (ready_max_priority () > t->priority)
+		intr_yield_on_return ();
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -377,8 +1033,8 @@ thread_get_recent_cpu (void) {
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   run queue.  It is returned by next_thread_to_run() as a
+   special case when the run queue is empty. */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
@@ -391,6 +1047,19 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* Spend the idle time zeroing pages for palloc, a page at
+		   a time, until somebody else wants the CPU. */
+		intr_enable ();
+		while (ready_cnt == 0 && palloc_zero_idle ())
+			continue;
+		intr_disable ();
+		if (ready_cnt != 0)
+			continue;
+
+		/* Stop the timer tick if nothing needs it soon.  The next
+		   interrupt, whatever it is, restarts it. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -430,21 +1099,25 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
-	t->priority = priority;
+	t->priority = t->base_priority = priority;
 	t->magic = THREAD_MAGIC;
-
-    t->donated = 0;
-
-	list_init(&t -> childs);
-    list_push_back(&(running_thread()->childs), &t->child_elem);
-	t -> is_waited = false;
-	t -> is_exited = false;
+	t->nice = running_thread ()->nice;
+	t->recent_cpu = running_thread ()->recent_cpu;
+	t->vruntime = min_vruntime;
+	list_init (&t->locks);
+	t->wait_on_lock = NULL;
+	t->wait_sema = NULL;
+	t->wait_cond = NULL;
+
+	list_init (&t->children);
+	t->exit_rec = NULL;
+#ifdef VM
+	work_group_init (&t->writebacks);
+#endif
     t -> parent_id = 0;
 	t -> fork_error = false;
     t -> cur_rsp = NULL;
 
-	sema_init(&t -> sema_exit, 0);
-	sema_init(&t -> sema_wait, 0);
     sema_init(&t -> sema_fork, 0);
 
 	//t -> files = (struct file *)malloc(sizeof(struct file *) * 128);
@@ -465,10 +1138,219 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct thread *t = ready_pop ();
+	return t != NULL ? t : idle_thread;
+}
+
+/* Appends T to the run queue list for its priority, or inserts
+   it into the CFS tree by virtual runtime. */
+static void
+ready_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (t->rt_period != 0)
+		rb_insert (&rt_tree, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_insert (&cfs_tree, &t->cfs_elem);
+		cfs_load += cfs_weight (t);
+	} else {
+		list_push_back (&ready_lists[t->priority], &t->elem);
+		ready_mask |= 1ULL << t->priority;
+	}
+	ready_cnt++;
+}
+
+/* Removes ready thread T from the run queue. */
+static void
+ready_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	if (t->rt_period != 0)
+		rb_remove (&rt_tree, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_remove (&cfs_tree, &t->cfs_elem);
+		cfs_load -= cfs_weight (t);
+	} else {
+		list_remove (&t->elem);
+		if (list_empty (&ready_lists[t->priority]))
+			ready_mask &= ~(1ULL << t->priority);
+	}
+	ready_cnt--;
+}
+
+/* Removes and returns the EDF thread with the earliest deadline,
+   or else the first thread of the highest nonempty priority level,
+   or under CFS the thread with the least virtual runtime, or a
+   null pointer if the run queue is empty. */
+static struct thread *
+ready_pop (void) {
+	struct list *l;
+	int pri;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!rb_empty (&rt_tree)) {
+		struct rb_elem *e = rb_min (&rt_tree);
+		rb_remove (&rt_tree, e);
+		ready_cnt--;
+		return rb_entry (e, struct thread, rt_elem);
+	}
+
+	if (thread_cfs) {
+		struct rb_elem *e = rb_min (&cfs_tree);
+		if (e == NULL)
+			return NULL;
+		struct thread *t = rb_entry (e, struct thread, cfs_elem);
+		rb_remove (&cfs_tree, e);
+		cfs_load -= cfs_weight (t);
+		ready_cnt--;
+		return t;
+	}
+
+	if (ready_mask == 0)
+		return NULL;
+	pri = 63 - __builtin_clzll (ready_mask);
+	l = &ready_lists[pri];
+	struct thread *t = list_entry (list_pop_front (l), struct thread, elem);
+	if (list_empty (l))
+		ready_mask &= ~(1ULL << pri);
+	ready_cnt--;
+	return t;
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   PRI_MIN - 1 if the run queue is empty.  CFS ignores priorities,
+   so under CFS no ready thread ever outranks the running one.  A
+   ready EDF thread that should preempt the running thread counts
+   as PRI_MAX + 1. */
+static int
+ready_max_priority (void) {
+	if (rt_preempts ())
+		return PRI_MAX + 1;
+	if (ready_mask == 0)
+		return PRI_MIN - 1;
+	return 63 - __builtin_clzll (ready_mask);
+}
+
+/* Returns true if a ready EDF thread should preempt the running
+   thread, because the running thread is not an EDF thread or its
+   deadline is later. */
+static bool
+rt_preempts (void) {
+	struct thread *curr = running_thread ();
+	struct rb_elem *e = rb_min (&rt_tree);
+
+	if (e == NULL)
+		return false;
+	return curr->rt_period == 0
+		|| rb_entry (e, struct thread, rt_elem)->rt_deadline < curr->rt_deadline;
+}
+
+/* Returns true if EDF thread A's deadline is earlier than B's. */
+static bool
+deadline_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, rt_elem);
+	const struct thread *b = rb_entry (b_, struct thread, rt_elem);
+
+	return a->rt_deadline < b->rt_deadline;
+}
+
+/* Charges running EDF thread T for one timer tick.  Starts T's
+   next period if its deadline has passed, and otherwise throttles
+   T once its budget is used up. */
+static void
+rt_tick (struct thread *t) {
+	int64_t now = timer_ticks ();
+
+	if (now >= t->rt_deadline)
+		rt_replenish (t, now);
+	else if (--t->rt_runtime <= 0) {
+		t->rt_throttled = true;
+		intr_yield_on_return ();
+	}
+}
+
+/* Starts a new period for EDF thread T, whose deadline is at or
+   before NOW.  The deadline just passed counts as missed unless T
+   finished its work for the period. */
+static void
+rt_replenish (struct thread *t, int64_t now) {
+	if (t->rt_job_done)
+		rt_met++;
+	else {
+		t->rt_missed++;
+		rt_missed++;
+	}
+	t->rt_job_done = false;
+	t->rt_throttled = false;
+	t->rt_runtime = t->rt_budget;
+	t->rt_deadline += t->rt_period * ((now - t->rt_deadline) / t->rt_period + 1);
+}
+
+/* Returns the CFS weight of T, derived from its nice value. */
+static int
+cfs_weight (const struct thread *t) {
+	return nice_to_weight[t->nice - NICE_MIN];
+}
+
+/* Returns true if ready thread A has less virtual runtime than
+   ready thread B. */
+static bool
+vruntime_less (const struct rb_elem *a_, const struct rb_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = rb_entry (a_, struct thread, cfs_elem);
+	const struct thread *b = rb_entry (b_, struct thread, cfs_elem);
+
+	return a->vruntime < b->vruntime;
+}
+
+/* Charges running thread T for one timer tick under CFS.  A tick
+   advances the virtual runtime of a nice 0 thread by VRUNTIME_TICK
+   and that of other threads in inverse proportion to their
+   weight, then min_vruntime follows the least runnable thread. */
+static void
+cfs_tick (struct thread *t) {
+	int64_t least = t->vruntime;
+	struct rb_elem *e;
+
+	t->vruntime += (int64_t) VRUNTIME_TICK * NICE_0_WEIGHT / cfs_weight (t);
+
+	e = rb_min (&cfs_tree);
+	if (e != NULL && rb_entry (e, struct thread, cfs_elem)->vruntime < least)
+		least = rb_entry (e, struct thread, cfs_elem)->vruntime;
+	if (least > min_vruntime)
+		min_vruntime = least;
+}
+
+/* Places T, which is about to become ready, in virtual time.  A
+   thread that has been blocked may not bank the CPU time it gave
+   up for longer than half the target latency, or it could
+   monopolize the CPU after a long sleep. */
+static void
+cfs_place (struct thread *t) {
+	int64_t floor = min_vruntime - (int64_t) VRUNTIME_TICK * CFS_LATENCY / 2;
+
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+}
+
+/* Returns the length, in timer ticks, of the time slice that T
+   gets under CFS: its weighted share of the target latency, which
+   is stretched when there are so many runnable threads that each
+   would otherwise get less than the minimum granularity. */
+static unsigned
+cfs_time_slice (const struct thread *t) {
+	int64_t weight = cfs_weight (t);
+	int64_t period = CFS_LATENCY;
+	int64_t slice;
+
+	if (ready_cnt + 1 > CFS_LATENCY / CFS_MIN_GRANULARITY)
+		period = (int64_t) (ready_cnt + 1) * CFS_MIN_GRANULARITY;
+	slice = period * weight / (cfs_load + weight);
+	return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
 }
 
 /* Use iretq to launch the thread */
@@ -579,7 +1461,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -598,12 +1480,20 @@ schedule (void) {
 
 	/* Start new time slice. */
 	thread_ticks = 0;
+	time_slice = thread_cfs ? cfs_time_slice (next) : TIME_SLICE;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
 	process_activate (next);
 #endif
 
+	if (curr != next) {
+		TRACE (TRACE_SWITCH, curr->tid, next->tid);
+		account_switch (curr, next);
+		fpu_switch (next);
+	}
+	preempting = false;
+
 	if (curr != next) {
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
@@ -623,6 +1513,66 @@ schedule (void) {
 	}
 }
 
+/* Updates the context switch and run queue wait statistics for
+   a switch from PREV to NEXT. */
+static void
+account_switch (struct thread *prev, struct thread *next) {
+	if (preempting && prev->status == THREAD_READY) {
+		prev->involuntary_switches++;
+		involuntary_switches++;
+	} else {
+		prev->voluntary_switches++;
+		voluntary_switches++;
+	}
+
+	if (next != idle_thread) {
+		int64_t wait = timer_ticks () - next->ready_tick;
+		int b = wait > 0 ? 64 - __builtin_clzll (wait) : 0;
+
+		if (b >= WAIT_HIST_BUCKETS)
+			b = WAIT_HIST_BUCKETS - 1;
+		next->wait_ticks += wait;
+		wait_hist[b]++;
+	}
+}
+
+/* Returns a page for a new thread, from the pool of pages of
+   exited threads if possible, or a null pointer if memory is
+   exhausted.  The page is not zeroed. */
+static struct thread *
+thread_page_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_pool)) {
+		t = list_entry (list_pop_front (&thread_pool), struct thread, elem);
+		thread_pool_cnt--;
+		thread_pool_hits++;
+	} else
+		thread_pool_misses++;
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Returns the page of exited thread T to the pool, or to palloc
+   if the pool is full.  The most recently freed page is reused
+   first, since it is the most likely to still be in the cache. */
+static void
+thread_page_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_pool_cnt < THREAD_POOL_MAX) {
+		t->magic = 0;
+		list_push_front (&thread_pool, &t->elem);
+		thread_pool_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -634,4 +1584,12 @@ allocate_tid (void) {
 	lock_release (&tid_lock);
 
 	return tid;
-}
\ No newline at end of file
+}
+
+/* Adds T, whose tid has just been assigned, to the tid table. */
+static void
+tid_insert (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	list_push_back (&tid_buckets[(unsigned) t->tid % TID_BUCKET_CNT],
+			&t->tid_elem);
+}
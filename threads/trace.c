@@ -0,0 +1,116 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Size of the ring buffer.  Must yield a power of 2 records. */
+#define TRACE_PAGES 32
+#define TRACE_RECORDS (TRACE_PAGES * PGSIZE / sizeof (struct trace_record))
+
+/* True once the ring buffer exists and tracepoints record. */
+bool trace_enabled;
+
+static struct trace_record *trace_buf;  /* Ring buffer. */
+static uint64_t trace_head;             /* # of records ever written. */
+
+static void dump_line (const char *format, ...) PRINTF_FORMAT (1, 2);
+static uint64_t cycles_per_tick (void);
+
+/* Allocates the ring buffer and turns tracing on. */
+void
+trace_init (void) {
+	ASSERT ((TRACE_RECORDS & (TRACE_RECORDS - 1)) == 0);
+
+	trace_buf = palloc_get_multiple (PAL_ASSERT, TRACE_PAGES);
+	trace_head = 0;
+	trace_enabled = true;
+}
+
+/* Appends a record of EVENT with ARG0 and ARG1 to the ring
+   buffer, overwriting the oldest record if it is full.
+
+   Each writer claims its own slot with an atomic increment of
+   trace_head, so a tracepoint hit by an interrupt handler in the
+   middle of another one's write does not disturb it. */
+void
+trace_event (enum trace_event event, uint64_t arg0, uint64_t arg1) {
+	uint64_t seq = __atomic_fetch_add (&trace_head, 1, __ATOMIC_RELAXED);
+	struct trace_record *r = &trace_buf[seq % TRACE_RECORDS];
+
+	/* Not thread_current(), which asserts that the thread is
+	   running: tracepoints fire inside schedule() too. */
+	struct thread *t = pg_round_down (rrsp ());
+
+	r->tsc = rdtsc ();
+	r->event = event;
+	r->tid = t->tid;
+	r->arg0 = arg0;
+	r->arg1 = arg1;
+}
+
+/* Stops tracing and writes the contents of the ring buffer, oldest
+   record first, to the serial port, in the format that
+   utils/trace-decode reads. */
+void
+trace_dump (void) {
+	uint64_t seq, first;
+
+	if (!trace_enabled)
+		return;
+	trace_enabled = false;
+
+	first = trace_head > TRACE_RECORDS ? trace_head - TRACE_RECORDS : 0;
+	dump_line ("trace: begin %llu records, %llu dropped, "
+			"%llu cycles/tick, %d ticks/s\n",
+			trace_head - first, first, cycles_per_tick (), TIMER_FREQ);
+	for (seq = first; seq < trace_head; seq++) {
+		const struct trace_record *r = &trace_buf[seq % TRACE_RECORDS];
+		dump_line ("trace: %llx %u %d %llx %llx\n",
+				r->tsc, r->event, r->tid, r->arg0, r->arg1);
+	}
+	dump_line ("trace: end\n");
+}
+
+/* Formats a line of the dump and writes it to the serial port
+   only, bypassing the VGA console. */
+static void
+dump_line (const char *format, ...) {
+	char line[128];
+	va_list args;
+	const char *p;
+
+	va_start (args, format);
+	vsnprintf (line, sizeof line, format, args);
+	va_end (args);
+
+	for (p = line; *p != '\0'; p++)
+		serial_putc (*p);
+}
+
+/* Measures the time stamp counter's rate against the timer, so
+   that the decoder can convert record times to seconds.  Returns
+   0 if the timer is not running, because interrupts are off. */
+static uint64_t
+cycles_per_tick (void) {
+	int64_t tick;
+	uint64_t start;
+
+	if (intr_get_level () == INTR_OFF)
+		return 0;
+
+	tick = timer_ticks ();
+	while (timer_ticks () == tick)
+		continue;
+	start = rdtsc ();
+	tick = timer_ticks ();
+	while (timer_ticks () == tick)
+		continue;
+	return rdtsc () - start;
+}
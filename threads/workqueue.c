@@ -0,0 +1,212 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of worker threads and their priority.  Deferred work is
+   not urgent, but running it below PRI_DEFAULT would let any busy
+   thread starve it, and with it anybody in work_flush(). */
+#define WORKER_CNT 2
+#define WORKER_PRI PRI_DEFAULT
+
+/* Queue of pending work, in the order it was queued. */
+static struct list work_list;
+static struct lock work_lock;           /* Protects everything below. */
+static struct condition work_ready;     /* Signaled when work is queued. */
+static struct condition work_idle;      /* Signaled when nothing is left. */
+static int work_depth;                  /* # of items in work_list. */
+static int work_running;                /* # of items being run. */
+
+/* Statistics. */
+static long long work_queued_cnt;       /* # of items queued. */
+static long long work_run_cnt;          /* # of items run. */
+static long long work_cancel_cnt;       /* # of items cancelled. */
+static int work_max_depth;              /* Deepest the queue has been. */
+static long long work_latency;          /* Total ticks from queue to run. */
+static long long work_max_latency;      /* Longest wait to run. */
+
+static thread_func worker;
+static void work_group_finish (struct work_group *);
+
+/* Initializes the work queue and starts its worker threads. */
+void
+workqueue_init (void) {
+	int i;
+
+	list_init (&work_list);
+	lock_init (&work_lock);
+	cond_init (&work_ready);
+	cond_init (&work_idle);
+
+	for (i = 0; i < WORKER_CNT; i++) {
+		char name[16];
+
+		snprintf (name, sizeof name, "kworker/%d", i);
+		if (thread_create (name, WORKER_PRI, worker, NULL) == TID_ERROR)
+			PANIC ("cannot start work queue worker");
+	}
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void) {
+	printf ("Work queue: %lld queued, %lld run, %lld cancelled, "
+			"max depth %d, latency %lld avg, %lld max ticks\n",
+			work_queued_cnt, work_run_cnt, work_cancel_cnt, work_max_depth,
+			work_run_cnt > 0 ? work_latency / work_run_cnt : 0,
+			work_max_latency);
+}
+
+/* Initializes WORK to run FUNC. */
+void
+work_init (struct work *work, work_func *func) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->group = NULL;
+	work->pending = false;
+}
+
+/* Queues WORK to be run by a worker thread.  Returns false,
+   without queuing it again, if WORK is already pending. */
+bool
+work_queue (struct work *work) {
+	return work_queue_group (work, NULL);
+}
+
+/* Queues WORK as work_queue() does, and counts it as part of
+   GROUP, if GROUP is nonnull, until it finishes running or is
+   cancelled. */
+bool
+work_queue_group (struct work *work, struct work_group *group) {
+	bool queued = false;
+
+	ASSERT (!intr_context ());
+
+	lock_acquire (&work_lock);
+	if (!work->pending) {
+		work->pending = true;
+		work->group = group;
+		if (group != NULL)
+			group->pending++;
+		work->queued_tick = timer_ticks ();
+		list_push_back (&work_list, &work->elem);
+		if (++work_depth > work_max_depth)
+			work_max_depth = work_depth;
+		work_queued_cnt++;
+		cond_signal (&work_ready, &work_lock);
+		queued = true;
+	}
+	lock_release (&work_lock);
+
+	return queued;
+}
+
+/* Removes WORK from the queue if it has not started yet.  Returns
+   true if it was removed, in which case its function will not be
+   called, or false if it was not pending, in which case it may be
+   running or already finished. */
+bool
+work_cancel (struct work *work) {
+	bool cancelled = false;
+
+	ASSERT (!intr_context ());
+
+	lock_acquire (&work_lock);
+	if (work->pending) {
+		work->pending = false;
+		list_remove (&work->elem);
+		work_depth--;
+		work_cancel_cnt++;
+		work_group_finish (work->group);
+		if (work_depth == 0 && work_running == 0)
+			cond_broadcast (&work_idle, &work_lock);
+		cancelled = true;
+	}
+	lock_release (&work_lock);
+
+	return cancelled;
+}
+
+/* Waits until every queued item has finished running.  Must not
+   be called from a work function, which would wait for itself.
+   Code that only needs its own work done should use a work group
+   instead, rather than wait behind everybody else's. */
+void
+work_flush (void) {
+	ASSERT (!intr_context ());
+
+	lock_acquire (&work_lock);
+	while (work_depth > 0 || work_running > 0)
+		cond_wait (&work_idle, &work_lock);
+	lock_release (&work_lock);
+}
+
+/* Worker thread.  Runs queued work in FIFO order, forever. */
+static void
+worker (void *aux UNUSED) {
+	for (;;) {
+		struct work *work;
+		struct work_group *group;
+		int64_t latency;
+
+		lock_acquire (&work_lock);
+		while (list_empty (&work_list))
+			cond_wait (&work_ready, &work_lock);
+		work = list_entry (list_pop_front (&work_list), struct work, elem);
+		work->pending = false;
+		work_depth--;
+		work_running++;
+		group = work->group;
+		latency = timer_elapsed (work->queued_tick);
+		work_latency += latency;
+		if (latency > work_max_latency)
+			work_max_latency = latency;
+		lock_release (&work_lock);
+
+		/* WORK may be freed by its function. */
+		work->func (work);
+
+		lock_acquire (&work_lock);
+		work_running--;
+		work_run_cnt++;
+		work_group_finish (group);
+		if (work_depth == 0 && work_running == 0)
+			cond_broadcast (&work_idle, &work_lock);
+		lock_release (&work_lock);
+	}
+}
+
+/* Initializes GROUP as empty. */
+void
+work_group_init (struct work_group *group) {
+	ASSERT (group != NULL);
+
+	group->pending = 0;
+	cond_init (&group->done);
+}
+
+/* Waits until every item queued in GROUP has finished running or
+   been cancelled.  Must not be called from a work function in
+   GROUP, which would wait for itself. */
+void
+work_group_wait (struct work_group *group) {
+	ASSERT (!intr_context ());
+
+	lock_acquire (&work_lock);
+	while (group->pending > 0)
+		cond_wait (&group->done, &work_lock);
+	lock_release (&work_lock);
+}
+
+/* Notes that an item in GROUP, which may be null, has finished or
+   been cancelled.  work_lock must be held. */
+static void
+work_group_finish (struct work_group *group) {
+	if (group != NULL && --group->pending == 0)
+		cond_broadcast (&group->done, &work_lock);
+}
@@ -0,0 +1,223 @@
+/* Fast user-space mutexes ("futexes").
+
+   A futex is any aligned int in user memory.  User code does the
+   common, uncontended case of its synchronization entirely with
+   atomic instructions on that int, and only makes a system call
+   when it has to sleep or wake up a sleeper:
+
+   - futex_wait(ADDR, EXPECTED) puts the caller to sleep on ADDR,
+     but only if *ADDR still equals EXPECTED, checked atomically
+     with respect to futex_wake().  This closes the window between
+     user code deciding to sleep and actually sleeping.
+
+   - futex_wake(ADDR, N) wakes up to N threads sleeping on ADDR.
+
+   Processes in Pintos never share memory, so every futex is
+   private to one address space.  Today each process also has just
+   one thread, so no one else could ever wake a sleeper or change
+   the futex under it.  futex_wait() therefore sleeps only while
+   some other thread runs in the caller's address space; otherwise
+   it returns FUTEX_AGAIN at once instead of blocking forever.
+
+   Sleepers are kept in a hash table keyed on the address space's
+   page map and the futex's user virtual address.  Unlike the
+   physical address of the frame that holds it, that key stays the
+   same when the page is evicted and swapped back in, and is never
+   shared with another process that reuses the frame.  A queue
+   exists only while somebody sleeps on it. */
+
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Threads sleeping on one futex. */
+struct futex_queue {
+	struct hash_elem elem;      /* Element in futex_table. */
+	uint64_t *pml4;             /* Address space of the futex. */
+	int *uaddr;                 /* User virtual address of the futex. */
+	struct list waiters;        /* List of struct futex_waiter. */
+};
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+	struct list_elem elem;      /* Element in futex_queue's waiters. */
+	struct semaphore sema;      /* Upped by futex_wake(). */
+};
+
+static struct hash futex_table;         /* Queues that have sleepers. */
+static struct lock futex_lock;          /* Protects futex_table. */
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static bool futex_resolve (int *uaddr, bool fault_in);
+static struct futex_queue *futex_lookup (uint64_t *pml4, int *uaddr);
+
+/* Initializes the futex table. */
+void
+futex_init (void) {
+	hash_init (&futex_table, futex_hash, futex_less, NULL);
+	lock_init (&futex_lock);
+}
+
+/* If *UADDR equals EXPECTED, sleeps until another thread calls
+   futex_wake() on the same futex and returns 0.  If *UADDR differs,
+   or UADDR is not a valid futex, returns FUTEX_CHANGED at once.
+   If no other thread shares the caller's address space, and so
+   nothing could wake it, returns FUTEX_AGAIN at once instead of
+   sleeping.  The caller must recheck its condition in any case. */
+int
+futex_wait (int *uaddr, int expected) {
+	struct thread *t = thread_current ();
+	struct futex_queue *q;
+	struct futex_waiter w;
+	enum intr_level old_level;
+	int *kva;
+	int value;
+	bool shared = false;
+
+	/* Fault the page in before taking futex_lock, which must not
+	   be held across the disk I/O that may take.  The page can be
+	   evicted again before we read it, in which case we retry. */
+	for (;;) {
+		if (!futex_resolve (uaddr, true))
+			return FUTEX_CHANGED;
+		lock_acquire (&futex_lock);
+		old_level = intr_disable ();
+		kva = pml4_get_page (t->pml4, uaddr);
+		if (kva != NULL) {
+			value = *kva;
+			shared = thread_pml4_shared (t->pml4);
+		}
+		intr_set_level (old_level);
+		if (kva != NULL)
+			break;
+		lock_release (&futex_lock);
+	}
+	if (value != expected) {
+		lock_release (&futex_lock);
+		return FUTEX_CHANGED;
+	}
+	if (!shared) {
+		lock_release (&futex_lock);
+		return FUTEX_AGAIN;
+	}
+
+	q = futex_lookup (t->pml4, uaddr);
+	if (q == NULL) {
+		q = malloc (sizeof *q);
+		if (q == NULL) {
+			lock_release (&futex_lock);
+			return FUTEX_CHANGED;
+		}
+		q->pml4 = t->pml4;
+		q->uaddr = uaddr;
+		list_init (&q->waiters);
+		hash_insert (&futex_table, &q->elem);
+	}
+	sema_init (&w.sema, 0);
+	list_push_back (&q->waiters, &w.elem);
+	lock_release (&futex_lock);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up to N threads sleeping on the futex at UADDR, in the
+   order they went to sleep.  Returns the number woken, or -1 if
+   UADDR is not a valid futex. */
+int
+futex_wake (int *uaddr, int n) {
+	struct thread *t = thread_current ();
+	struct futex_queue *q;
+	int woken = 0;
+
+	/* Waking never reads the futex, so its page need not be in. */
+	if (!futex_resolve (uaddr, false))
+		return -1;
+
+	lock_acquire (&futex_lock);
+	q = futex_lookup (t->pml4, uaddr);
+	if (q != NULL) {
+		while (woken < n && !list_empty (&q->waiters)) {
+			struct futex_waiter *w = list_entry (list_pop_front (&q->waiters),
+					struct futex_waiter, elem);
+			sema_up (&w->sema);
+			woken++;
+		}
+		if (list_empty (&q->waiters)) {
+			hash_delete (&futex_table, &q->elem);
+			free (q);
+		}
+	}
+	lock_release (&futex_lock);
+
+	return woken;
+}
+
+/* Returns true if UADDR is an aligned address in a page that the
+   current process has.  If FAULT_IN is true, also brings the page
+   into memory if it is not already, which may take disk I/O, so
+   futex_lock must not be held. */
+static bool
+futex_resolve (int *uaddr, bool fault_in UNUSED) {
+	struct thread *t = thread_current ();
+
+	if (uaddr == NULL || !is_user_vaddr (uaddr)
+			|| (uintptr_t) uaddr % sizeof *uaddr != 0)
+		return false;
+
+	if (pml4_get_page (t->pml4, uaddr) != NULL)
+		return true;
+#ifdef VM
+	if (fault_in)
+		return vm_claim_page (uaddr);
+	return spt_find_page (&t->spt, uaddr) != NULL;
+#else
+	return false;
+#endif
+}
+
+/* Returns the queue for the futex at UADDR in the address space
+   with page map PML4, or a null pointer if nobody is sleeping on
+   it. */
+static struct futex_queue *
+futex_lookup (uint64_t *pml4, int *uaddr) {
+	struct futex_queue q;
+	struct hash_elem *e;
+
+	q.pml4 = pml4;
+	q.uaddr = uaddr;
+	e = hash_find (&futex_table, &q.elem);
+	return e != NULL ? hash_entry (e, struct futex_queue, elem) : NULL;
+}
+
+/* Returns a hash value for futex queue E. */
+static uint64_t
+futex_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct futex_queue *q = hash_entry (e, struct futex_queue, elem);
+	return hash_bytes (&q->pml4, sizeof q->pml4)
+		^ hash_bytes (&q->uaddr, sizeof q->uaddr);
+}
+
+/* Returns true if futex queue A precedes futex queue B. */
+static bool
+futex_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct futex_queue *qa = hash_entry (a, struct futex_queue, elem);
+	const struct futex_queue *qb = hash_entry (b, struct futex_queue, elem);
+
+	if (qa->pml4 != qb->pml4)
+		return qa->pml4 < qb->pml4;
+	return qa->uaddr < qb->uaddr;
+}
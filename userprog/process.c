@@ -1,5 +1,6 @@
 #include "userprog/process.h"
 #include <debug.h>
+#include <hash.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
@@ -12,12 +13,15 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -28,6 +32,36 @@ static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
 static void argument_passing (const char *file_name, struct intr_frame *if_);
+static tid_t spawn_child (const char *name, thread_func *, void *aux);
+static struct exit_record *exit_record_find (tid_t);
+static void exit_record_disown (struct exit_record *);
+static hash_hash_func exit_record_hash;
+static hash_less_func exit_record_less;
+
+/* Exit status of a child process, kept for its parent.  The child
+   fills it in as it exits, so that its thread can be destroyed at
+   once instead of lingering until the parent waits for it.  The
+   parent frees the record after waiting; if it never waits, the
+   record is freed by whichever of the two exits last. */
+struct exit_record {
+	struct hash_elem elem;          /* Element in exit_records. */
+	struct list_elem child_elem;    /* Element in parent's children. */
+	tid_t tid;                      /* Child's thread id. */
+	struct thread *parent;          /* Parent, or null once orphaned. */
+	int status;                     /* Exit status, once exited. */
+	bool exited;                    /* Has the child exited? */
+	struct semaphore dead;          /* Upped when the child exits. */
+};
+
+static struct hash exit_records;        /* Records not yet waited for. */
+static struct lock exit_lock;           /* Protects every exit record. */
+
+/* Initializes the table of exit records. */
+void
+process_table_init (void) {
+	hash_init (&exit_records, exit_record_hash, exit_record_less, NULL);
+	lock_init (&exit_lock);
+}
 
 /* General process initializer for initd and other process. */
 static void
@@ -55,7 +89,7 @@ process_create_initd (const char *file_name) {
 
 	/* Create a new thread to execute FILE_NAME. */
     
-	tid = thread_create (strtok_r(file_name," ", &ptr), PRI_DEFAULT, initd, fn_copy); //file name을 parsing 후 대입
+	tid = spawn_child (strtok_r(file_name," ", &ptr), initd, fn_copy); //file name을 parsing 후 대입
 	if (tid == TID_ERROR)
 		palloc_free_page (fn_copy);
 	return tid;
@@ -86,7 +120,7 @@ process_fork (const char *name, struct intr_frame *if_) {
     //memcpy ( &thread_current()->tf , if_, sizeof (struct intr_frame));
     curr -> temp_tf = if_;
     
-    tid_t tid = thread_create (name, PRI_DEFAULT, __do_fork, thread_current());
+    tid_t tid = spawn_child (name, __do_fork, thread_current());
 
 	if (tid == TID_ERROR) {
 		return tid;
@@ -94,6 +128,10 @@ process_fork (const char *name, struct intr_frame *if_) {
     sema_down(&curr -> sema_fork); //부모가 자식이 복제할 때까지 기다려줌
 
 	if (curr -> fork_error) {
+        // nobody will wait for the failed child
+        lock_acquire(&exit_lock);
+        exit_record_disown(exit_record_find(tid));
+        lock_release(&exit_lock);
 		return TID_ERROR;
 	}
     
@@ -198,6 +236,10 @@ __do_fork (void *aux) {
             current -> files[i] = file_duplicate(parent -> files[i]);
         }
 	}
+
+	/* The child starts with the parent's FPU and SIMD registers. */
+	if (!fpu_fork (current, parent))
+		goto error;
 	
 	
 	process_init ();
@@ -213,7 +255,6 @@ __do_fork (void *aux) {
 error:
     parent -> fork_error = true;
 	sema_up(&parent -> sema_fork);
-	sema_up(&current -> sema_exit);
 
 	thread_exit ();
 }
@@ -293,82 +334,116 @@ process_exec2 (void *f_name) {
  * been successfully called for the given TID, returns -1
  * immediately, without waiting.
  *
- * This function will be implemented in problem 2-2.  For now, it
- * does nothing. */
+ * The child is found through its exit record, which outlives the
+ * child itself, so this costs the same however many children the
+ * process has and whether or not TID has already exited. */
 int
 process_wait (tid_t child_tid) {
-	/* XXX: Hint) The pintos exit if process_wait (initd), we recommend you
-	 * XXX:       to add infinite loop here before
-	 * XXX:       implementing the process_wait. */
- /*   for (int i =0 ; i<1000000000; i++){
+	struct thread *curr = thread_current ();
+	struct exit_record *rec;
+	int status;
 
-    }
-    return 1;*/
-    
-    //printf("%d\n",child_tid);
-	struct thread *current = thread_current();
-	struct thread *child;
-	int exit_status;
+	lock_acquire (&exit_lock);
+	rec = exit_record_find (child_tid);
+	if (rec == NULL || rec->parent != curr) {
+		lock_release (&exit_lock);
+		return -1;
+	}
+	/* Out of the table, so that waiting on it again fails. */
+	hash_delete (&exit_records, &rec->elem);
+	list_remove (&rec->child_elem);
+	lock_release (&exit_lock);
+
+	sema_down (&rec->dead);
+	status = rec->status;
+	free (rec);
+	return status;
+}
 
-	child = get_child_process(child_tid);
-	if (child == NULL){
-     //printf("1\n");
-     return -1;
-    } // pid doesn't refer to direct child of the calling process.
-    
-    if (child -> is_waited == true){
-        return -1;
-    }
-    /*
-    if(!(child -> is_exited)){
-        sema_down(&child -> sema_wait);
-	    exit_status = child -> exit_status;
-	    sema_up(&child -> sema_exit);
-    }
-    else{
-        exit_status = child -> exit_status;
-    }*/
-    sema_down(&child -> sema_wait);
-	exit_status = child -> exit_status;
-	sema_up(&child -> sema_exit);
+/* Creates a child thread as thread_create() does, and gives it an
+ * exit record for the current thread to collect with
+ * process_wait().  Returns the child's tid, or TID_ERROR. */
+static tid_t
+spawn_child (const char *name, thread_func *function, void *aux) {
+	struct thread *curr = thread_current ();
+	struct exit_record *rec;
+	struct thread *child;
+	enum intr_level old_level;
+	tid_t tid;
 
-	//remove_child_process(child);
-    child -> is_waited = true;
+	rec = malloc (sizeof *rec);
+	if (rec == NULL)
+		return TID_ERROR;
+	rec->parent = curr;
+	rec->status = -1;
+	rec->exited = false;
+	sema_init (&rec->dead, 0);
+
+	/* The child cannot get through process_exit() while we hold
+	 * exit_lock, so it is still around to be handed its record. */
+	lock_acquire (&exit_lock);
+	tid = thread_create (name, PRI_DEFAULT, function, aux);
+	if (tid == TID_ERROR) {
+		lock_release (&exit_lock);
+		free (rec);
+		return TID_ERROR;
+	}
+	old_level = intr_disable ();
+	child = thread_find (tid);
+	ASSERT (child != NULL);
+	child->exit_rec = rec;
+	intr_set_level (old_level);
+
+	rec->tid = tid;
+	hash_insert (&exit_records, &rec->elem);
+	list_push_back (&curr->children, &rec->child_elem);
+	lock_release (&exit_lock);
+	return tid;
+}
 
-	//if (child -> is_exited) return child -> exit_status; // process exited by exit()
+/* Returns the exit record for TID, or a null pointer if there is
+ * none.  Must be called with exit_lock held. */
+static struct exit_record *
+exit_record_find (tid_t tid) {
+	struct exit_record key;
+	struct hash_elem *e;
 
-    //printf("%d\n",exit_status);
-	return exit_status; // process not exited by exit() maybe by exception
+	ASSERT (lock_held_by_current_thread (&exit_lock));
 
-	// have to deal with nested wait calls
-	//return -1;
+	key.tid = tid;
+	e = hash_find (&exit_records, &key.elem);
+	return e != NULL ? hash_entry (e, struct exit_record, elem) : NULL;
 }
-struct thread *
-get_child_process(tid_t pid) {
-	struct thread *current = thread_current();
-	struct list_elem *e;
 
-	if (list_size(&current -> childs) == 0) {
-        
-		return NULL;
-	} else {
-		for (e = list_begin(&current -> childs); e != list_end(&current -> childs); e = list_next(e)) {
-			if (list_entry(e, struct thread, child_elem) -> tid == pid) {
-                
-				return list_entry(e, struct thread, child_elem);
-			}
-		}
-	}
-    
-	return NULL;	
+/* Gives up the current thread's claim on REC, one of its
+ * children's exit records, without waiting for the child.  Must be
+ * called with exit_lock held. */
+static void
+exit_record_disown (struct exit_record *rec) {
+	ASSERT (lock_held_by_current_thread (&exit_lock));
+	ASSERT (rec->parent == thread_current ());
+
+	hash_delete (&exit_records, &rec->elem);
+	list_remove (&rec->child_elem);
+	if (rec->exited)
+		free (rec);
+	else
+		rec->parent = NULL;
 }
 
-void
-remove_child_process(struct thread *thr) {
-	struct thread *current = thread_current();
+/* Returns a hash value for exit record E. */
+static uint64_t
+exit_record_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct exit_record *rec = hash_entry (e, struct exit_record, elem);
+	return hash_int (rec->tid);
+}
 
-	list_remove(&current -> child_elem);
-	// release process descripter momory -> thread_exit? 이건 여기서 하면 안될거 같은데 
+/* Returns true if exit record A precedes exit record B. */
+static bool
+exit_record_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct exit_record, elem)->tid
+		< hash_entry (b, struct exit_record, elem)->tid;
 }
 
 /* Exit the process. This function is called by thread_exit (). */
@@ -378,6 +453,11 @@ process_exit (void) {
     
 
     supplemental_page_table_kill (&curr->spt);
+#ifdef VM
+	/* Our mapped files must be written back before our parent,
+	 * which may read them, learns that we have exited. */
+	work_group_wait (&curr->writebacks);
+#endif
 
     for(int i=3; i<128; i++){
 		if(curr->files[i] != NULL){
@@ -385,9 +465,25 @@ process_exit (void) {
         }
     }
 
-    sema_up(&curr -> sema_wait);
-	sema_down(&curr -> sema_exit);
-    list_remove(&curr -> child_elem);
+	/* Hand our exit status to our parent, and let go of our own
+	 * children.  Nothing waits for this thread itself, so it is
+	 * destroyed as soon as it finishes exiting. */
+	lock_acquire (&exit_lock);
+	while (!list_empty (&curr->children))
+		exit_record_disown (list_entry (list_front (&curr->children),
+					struct exit_record, child_elem));
+	if (curr->exit_rec != NULL) {
+		struct exit_record *rec = curr->exit_rec;
+
+		rec->status = curr->exit_status;
+		rec->exited = true;
+		if (rec->parent == NULL)
+			free (rec);
+		else
+			sema_up (&rec->dead);
+		curr->exit_rec = NULL;
+	}
+	lock_release (&exit_lock);
 	//printf("2\n");
 	process_cleanup ();
 	//printf("reachable?\n");
@@ -398,6 +494,9 @@ static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
+	/* The FPU state belongs to the program being torn down. */
+	fpu_release ();
+
 #ifdef VM
 	//supplemental_page_table_kill (&curr->spt);
 #endif
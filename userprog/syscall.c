@@ -11,6 +11,8 @@
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
+#include "threads/trace.h"
 #include "vm/file.h"
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -57,6 +59,8 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	futex_init ();
 }
 
 /* The main system call interface */
@@ -73,6 +77,7 @@ syscall_handler (struct intr_frame *f) {
     arg[6] = f->R.r9;
 
     thread_current()->cur_rsp = f->rsp;
+    TRACE(TRACE_SYSCALL, arg[0], arg[1]);
     /*
     check_arg(arg[0]);
     printf("syscall: %d\n",*(int *)arg[0]);
@@ -127,13 +132,24 @@ syscall_handler (struct intr_frame *f) {
         case SYS_MUNMAP:
             munmap(arg[1]);
             break;
+        case SYS_FUTEX_WAIT:
+            /* Processes are single-threaded, so a futex_wait() that
+               would sleep has nobody to wake it.  It fails with
+               FUTEX_AGAIN instead; see userprog/futex.c. */
+            check_arg((int *) arg[1]);
+            f->R.rax = futex_wait((int *) arg[1], arg[2]);
+            break;
+        case SYS_FUTEX_WAKE:
+            check_arg((int *) arg[1]);
+            f->R.rax = futex_wake((int *) arg[1], arg[2]);
+            break;
 
         default :
             thread_exit ();
 
 
     }
-    
+    TRACE(TRACE_SYSRET, arg[0], f->R.rax);
 }
 /*
 static int
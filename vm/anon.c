@@ -1,8 +1,34 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <string.h>
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "threads/workqueue.h"
+
+/* A page's contents on their way to its swap slot.  Swap-out
+ * copies the frame into a kernel page, so that the evicted frame
+ * can be reused at once, and leaves the disk write to the work
+ * queue.  At most SWAP_WRITE_MAX copies are in flight at a time;
+ * beyond that, pages are written synchronously.
+ *
+ * The work function frees the copy once it is written, unless the
+ * page's owner is waiting for it, in which case the owner does. */
+struct swap_write {
+	struct work work;           /* Deferred work. */
+	struct page *page;          /* Page being swapped out. */
+	size_t slot;                /* Swap slot to write. */
+	uint8_t *buffer;            /* Copy of the page. */
+	bool waited;                /* Is the owner waiting on DONE? */
+	struct semaphore done;      /* Upped when written, if WAITED. */
+};
+
+#define SWAP_WRITE_MAX 16
+static int swap_writes;         /* # of swap_writes in flight. */
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -12,6 +38,10 @@ static struct bitmap *swap_map;
 static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
+static bool swap_write_queue (struct page *page, size_t slot);
+static void swap_write (struct work *);
+static void swap_write_free (struct swap_write *);
+static void swap_write_wait (struct page *page, void *kva);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
@@ -48,6 +78,7 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
     (page->frame)->kva = kva;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->swap_write = NULL;
 
     return true;
 }
@@ -62,10 +93,14 @@ anon_swap_in (struct page *page, void *kva) {
 	size_t index = page -> swap_index;
 	//printf("c\n");
 
-	for (int i = index*8; i < index*8 + 8; i++) {
-		//printf("d\n");
-		rest = i%8;
-		disk_read(swap_disk, i, kva + rest*DISK_SECTOR_SIZE);
+	if (anon_page->swap_write != NULL)
+		swap_write_wait (page, kva);
+	else {
+		for (int i = index*8; i < index*8 + 8; i++) {
+			//printf("d\n");
+			rest = i%8;
+			disk_read(swap_disk, i, kva + rest*DISK_SECTOR_SIZE);
+		}
 	}
 	page -> swapped_out = false;
 
@@ -97,10 +132,12 @@ anon_swap_out (struct page *page) {
 	
 	page -> swap_index = empty_bit;
 	page -> swapped_out = true;
-	for (int i = empty_bit*8; i < empty_bit*8 + 8; i++) {
-		//do_nothing();
-		rest = i%8;
-		disk_write(swap_disk, i, (page -> frame) -> kva + rest*DISK_SECTOR_SIZE);
+	if (!swap_write_queue (page, empty_bit)) {
+		for (int i = empty_bit*8; i < empty_bit*8 + 8; i++) {
+			//do_nothing();
+			rest = i%8;
+			disk_write(swap_disk, i, (page -> frame) -> kva + rest*DISK_SECTOR_SIZE);
+		}
 	}
 	//free(page -> frame);
 	bitmap_flip(swap_map, empty_bit);
@@ -113,8 +150,122 @@ anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
 
     //palloc_free_page((page -> frame) -> kva);
+	if (anon_page->swap_write != NULL)
+		swap_write_wait (page, NULL);
 	if (!page -> swapped_out)
-		free(page -> frame);
+		vm_free_frame(page -> frame);
     free(page->info);
 	
-}
\ No newline at end of file
+}
+/* Copies PAGE's frame and queues the copy to be written to swap
+ * slot SLOT.  Returns false if too many writes are in flight or
+ * memory is short, in which case the caller must write the page
+ * itself. */
+static bool
+swap_write_queue (struct page *page, size_t slot) {
+	struct swap_write *w;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (swap_writes >= SWAP_WRITE_MAX) {
+		intr_set_level (old_level);
+		return false;
+	}
+	swap_writes++;
+	intr_set_level (old_level);
+
+	w = malloc (sizeof *w);
+	if (w != NULL)
+		w->buffer = palloc_get_page (0);
+	if (w == NULL || w->buffer == NULL) {
+		free (w);
+		old_level = intr_disable ();
+		swap_writes--;
+		intr_set_level (old_level);
+		return false;
+	}
+
+	w->page = page;
+	w->slot = slot;
+	w->waited = false;
+	sema_init (&w->done, 0);
+	memcpy (w->buffer, page->frame->kva, PGSIZE);
+	page->anon.swap_write = w;
+	work_init (&w->work, swap_write);
+	work_queue (&w->work);
+	return true;
+}
+
+/* Writes a copied page to its swap slot.  Runs on the work queue. */
+static void
+swap_write (struct work *work) {
+	struct swap_write *w = work_entry (work, struct swap_write, work);
+	enum intr_level old_level;
+	bool waited;
+
+	for (int i = 0; i < 8; i++)
+		disk_write (swap_disk, w->slot * 8 + i, w->buffer + i * DISK_SECTOR_SIZE);
+
+	old_level = intr_disable ();
+	waited = w->waited;
+	if (!waited)
+		w->page->anon.swap_write = NULL;
+	intr_set_level (old_level);
+
+	if (waited)
+		sema_up (&w->done);
+	else
+		swap_write_free (w);
+}
+
+/* Frees W and its copy of the page. */
+static void
+swap_write_free (struct swap_write *w) {
+	enum intr_level old_level;
+
+	palloc_free_page (w->buffer);
+	free (w);
+	old_level = intr_disable ();
+	swap_writes--;
+	intr_set_level (old_level);
+}
+
+/* Deals with PAGE's queued swap write before PAGE is swapped in
+ * to KVA or, if KVA is null, destroyed.  If the write has not
+ * started, it is cancelled and the contents come straight from
+ * the copy; otherwise we wait for that write alone to reach the
+ * disk, not for the rest of the work queue. */
+static void
+swap_write_wait (struct page *page, void *kva) {
+	struct swap_write *w = page->anon.swap_write;
+	enum intr_level old_level;
+	bool waited;
+
+	if (work_cancel (&w->work)) {
+		if (kva != NULL)
+			memcpy (kva, w->buffer, PGSIZE);
+		page->anon.swap_write = NULL;
+		swap_write_free (w);
+		return;
+	}
+
+	/* The write is running or done.  If it is not done, ask the
+	 * work function to leave W to us and wait for it; the copy is
+	 * then still there to take the contents from. */
+	old_level = intr_disable ();
+	waited = page->anon.swap_write != NULL;
+	if (waited)
+		w->waited = true;
+	intr_set_level (old_level);
+
+	if (waited) {
+		sema_down (&w->done);
+		if (kva != NULL)
+			memcpy (kva, w->buffer, PGSIZE);
+		page->anon.swap_write = NULL;
+		swap_write_free (w);
+	} else if (kva != NULL)
+		for (int i = 0; i < 8; i++)
+			disk_read (swap_disk, page->swap_index * 8 + i,
+					(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+}
@@ -1,12 +1,27 @@
 /* file.c: Implementation of memory mapped file object (mmaped object). */
 
+#include <string.h>
 #include "vm/vm.h"
 #include "userprog/process.h"
+#include "threads/malloc.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
+
+/* A dirty mapped page's contents, copied out so that the work
+ * queue can write them back after the mapping is gone. */
+struct file_writeback {
+	struct work work;           /* Deferred work. */
+	struct file *file;          /* File to write, closed when done. */
+	off_t offset;               /* Offset in FILE. */
+	size_t size;                /* Number of bytes in DATA. */
+	uint8_t data[];             /* Contents of the page. */
+};
 
 static bool file_map_swap_in (struct page *page, void *kva);
 static bool file_map_swap_out (struct page *page);
 static void file_map_destroy (struct page *page);
+static bool file_writeback_queue (struct page *page);
+static void file_writeback (struct work *);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations file_ops = {
@@ -75,20 +90,19 @@ file_map_destroy (struct page *page) {
     struct thread *current = thread_current();
 
 
-        if (pml4_is_dirty(current -> pml4, page -> va)){ // 도대체 dirty bit은 어디서 설정해주지?
-            
-            if (page -> writable){ 
-                
-             
+        bool dirty = pml4_is_dirty(current -> pml4, page -> va) && page -> writable;
+
+        /* Write back in the background if we can, so that munmap
+         * and exit do not wait for the disk.  The work closes the
+         * file once the data is written. */
+        if (!dirty || !file_writeback_queue (page)) {
+            if (dirty)
                 file_write_at(page -> file_to_write, page->va, page -> byte_to_write, page -> offset);
-                
-            }
+            file_close(page->file_to_write);
         }
 
-        file_close(page->file_to_write);
-
         if (!page -> swapped_out){
-            free(page -> frame);
+            vm_free_frame(page -> frame);
         }
 		
         free(page -> info);
@@ -128,6 +142,35 @@ lazy_load_segment2 (struct page *page, void *aux) {
 	/* TODO: VA is available when calling this function. */
 }
 
+/* Copies dirty mapped PAGE and queues the copy to be written
+ * back to its file, as one of the current thread's write-backs.
+ * Returns false if memory is short, in which
+ * case the caller must write the page itself. */
+static bool
+file_writeback_queue (struct page *page) {
+	struct file_writeback *wb = malloc (sizeof *wb + page->byte_to_write);
+
+	if (wb == NULL)
+		return false;
+	wb->file = page->file_to_write;
+	wb->offset = page->offset;
+	wb->size = page->byte_to_write;
+	memcpy (wb->data, page->va, wb->size);
+	work_init (&wb->work, file_writeback);
+	work_queue_group (&wb->work, &thread_current ()->writebacks);
+	return true;
+}
+
+/* Writes back a copied page.  Runs on the work queue. */
+static void
+file_writeback (struct work *work) {
+	struct file_writeback *wb = work_entry (work, struct file_writeback, work);
+
+	file_write_at (wb->file, wb->data, wb->size, wb->offset);
+	file_close (wb->file);
+	free (wb);
+}
+
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
@@ -219,5 +262,10 @@ do_munmap (void *addr) {
         // 이 과정에서 writeback을 해야 할 수도 있음
     }
 
+    /* munmap is synchronous: the data must be in the file before
+     * the process can read it back.  Other processes' queued disk
+     * work need not be. */
+    work_group_wait (&thread_current ()->writebacks);
+
 
 }
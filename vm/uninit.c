@@ -69,7 +69,7 @@ uninit_destroy (struct page *page) {
 	struct uninit_page *uninit UNUSED = &page->uninit;
 
     if(page_get_type(page) == VM_MARKER_0){
-        free(page->frame);
+        vm_free_frame(page->frame);
     }
     free(page->info);
 	/* TODO: Fill this function.
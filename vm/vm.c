@@ -4,13 +4,20 @@
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "threads/vaddr.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 #include "lib/kernel/hash.h"
 #include "lib/kernel/list.h"
 
 struct list frame_table;
 struct lock frame_lock;
+
+/* Caches for the page and frame structures, which are allocated
+ * and freed on every page fault and eviction. */
+static struct slab_cache page_cache;
+static struct slab_cache frame_cache;
 struct list_elem *cursor;
 //struct swap_table *swap_table;
 
@@ -28,6 +35,8 @@ vm_init (void) {
 	/* TODO: Your code goes here. */
     list_init(&frame_table);
     lock_init(&frame_lock);
+    slab_init(&page_cache, "page", sizeof (struct page), 0, NULL);
+    slab_init(&frame_cache, "frame", sizeof (struct frame), 0, NULL);
     cursor = NULL;
     /*
     struct swap_table *swap_table = malloc(sizeof(struct swap_table));
@@ -70,7 +79,9 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
         struct page *p;
-        p = (struct page *) malloc (sizeof (struct page));
+        p = slab_alloc(&page_cache);
+        if (p == NULL)
+            goto err;
        
         switch(VM_TYPE(type)){
             case 1:
@@ -96,7 +107,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
                 p->swapped_out = false;
                 break;
             default:
-                
+                slab_free(&page_cache, p);
                 goto err;
         }
 /*
@@ -265,8 +276,6 @@ vm_get_frame (void) {
 	//struct frame *frame = NULL;
     struct frame *frame;
     struct frame *victim;
-    frame = (struct frame *) malloc (sizeof (struct frame));
-
     uint8_t *newpage;
 
     
@@ -282,6 +291,9 @@ vm_get_frame (void) {
         return victim;
     }
     
+    frame = slab_alloc(&frame_cache);
+    if (frame == NULL)
+        PANIC("can not allocate frame");
     //printf("7\n");
     frame->kva = newpage; // kva와 매핑 맞나
     frame->counter = 0;
@@ -328,6 +340,10 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 		bool user, bool write , bool not_present ) {
 	struct supplemental_page_table *spt = &thread_current ()->spt;
 
+	TRACE (TRACE_PAGE_FAULT, addr, (write ? TRACE_PF_WRITE : 0)
+			| (user ? TRACE_PF_USER : 0)
+			| (not_present ? TRACE_PF_NOT_PRESENT : 0));
+
     bool limited_size = addr > (USER_STACK - 0x100000); //1MB
     uintptr_t rsp;
 
@@ -419,7 +435,13 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	slab_free (&page_cache, page);
+}
+
+/* Frees FRAME, which came from vm_get_frame(). */
+void
+vm_free_frame (struct frame *frame) {
+	slab_free (&frame_cache, frame);
 }
 
 /* Claim the page that allocate on VA. */
@@ -462,7 +484,7 @@ vm_do_claim_page (struct page *page) {
     else{
         printf("!!!!!!!\n");
         palloc_free_page (frame->kva);
-        free(frame);
+        vm_free_frame(frame);
         return false;
     }
             